@@ -0,0 +1,262 @@
+#include <pthread.h>
+#include <time.h>
+#include "access_log.h"
+#include "mpmc.h"
+
+// every thread that logs owns a single-producer ring, so logging a request
+// takes no lock and never waits on the log file; a background writer drains
+// all the rings every ACCESS_LOG_FLUSH_MS and writes the lines in batches
+
+typedef struct
+{
+  long long time_us; // wall clock time the response was finished
+  long long bytes;   // bytes sent, headers included
+  long long wait_us; // time in the request queue
+  long long service_us;
+  int status;
+  char method[8];
+  char uri[ACCESS_LOG_URI_MAX];
+} access_log_entry_t;
+
+typedef struct access_log_ring
+{
+  _Alignas(CACHE_LINE) _Atomic unsigned long long head; // next entry the writer reads
+  _Alignas(CACHE_LINE) _Atomic unsigned long long tail; // next entry the owner writes
+  unsigned long long seen;            // requests offered by the owner, for sampling
+  _Atomic long long dropped;
+  _Atomic int owned;                  // a live thread logs into the ring
+  struct access_log_ring *next;       // all rings, never removed
+  access_log_entry_t entries[ACCESS_LOG_RING_SIZE];
+} access_log_ring_t;
+
+static _Atomic(access_log_ring_t *) rings;
+static pthread_key_t ring_key;
+static __thread access_log_ring_t *my_ring;
+
+static int log_fd = -1;
+static _Atomic int sample_rate;
+static _Atomic int enabled = 1;
+static _Atomic long long logged;
+
+/**
+ * hands the ring of an exiting thread back, so a thread started later (the
+ * elastic pool starts and retires workers) can take it over
+ */
+static void access_log_release(void *arg)
+{
+  access_log_ring_t *ring = (access_log_ring_t *)arg;
+  atomic_store_explicit(&ring->owned, 0, memory_order_release);
+}
+
+/**
+ * finds the calling thread's ring, claiming an unowned one or adding a new
+ * one on the thread's first request
+ *
+ * @return the ring, or NULL if memory ran out
+ */
+static access_log_ring_t *access_log_ring(void)
+{
+  if (my_ring)
+    return my_ring;
+
+  access_log_ring_t *ring;
+  for (ring = atomic_load(&rings); ring; ring = ring->next)
+  {
+    int expected = 0;
+    if (atomic_compare_exchange_strong(&ring->owned, &expected, 1))
+      break;
+  }
+  if (!ring)
+  {
+    ring = (access_log_ring_t *)aligned_alloc(CACHE_LINE, sizeof(access_log_ring_t));
+    if (!ring)
+      return NULL;
+    memset(ring, 0, sizeof(*ring));
+    atomic_init(&ring->owned, 1);
+    ring->next = atomic_load(&rings);
+    while (!atomic_compare_exchange_weak(&rings, &ring->next, ring))
+      ;
+  }
+  my_ring = ring;
+  pthread_setspecific(ring_key, ring);
+  return ring;
+}
+
+/**
+ * appends a string to a log line as a JSON string, escaping quotes,
+ * backslashes and control characters
+ */
+static int access_log_escape(char *out, const char *s)
+{
+  int len = 0;
+  out[len++] = '"';
+  for (; *s; s++)
+  {
+    unsigned char c = (unsigned char)*s;
+    if (c == '"' || c == '\\')
+    {
+      out[len++] = '\\';
+      out[len++] = c;
+    }
+    else if (c < 0x20 || c == 0x7f)
+    {
+      len += sprintf(out + len, "\\u%04x", c);
+    }
+    else
+    {
+      out[len++] = c;
+    }
+  }
+  out[len++] = '"';
+  return len;
+}
+
+/**
+ * formats an entry as one JSON line
+ *
+ * @param out room for at least 8 * ACCESS_LOG_URI_MAX bytes
+ * @return the length of the line
+ */
+static int access_log_format(char *out, const access_log_entry_t *entry)
+{
+  time_t secs = entry->time_us / 1000000;
+  struct tm tm;
+  gmtime_r(&secs, &tm);
+
+  int len = sprintf(out, "{\"time\":\"%04d-%02d-%02dT%02d:%02d:%02d.%03dZ\",\"method\":",
+                    tm.tm_year + 1900, tm.tm_mon + 1, tm.tm_mday, tm.tm_hour, tm.tm_min, tm.tm_sec,
+                    (int)(entry->time_us / 1000 % 1000));
+  len += access_log_escape(out + len, entry->method);
+  len += sprintf(out + len, ",\"uri\":");
+  len += access_log_escape(out + len, entry->uri);
+  len += sprintf(out + len, ",\"status\":%d,\"bytes\":%lld,\"queue_us\":%lld,\"service_us\":%lld}\n",
+                 entry->status, entry->bytes, entry->wait_us, entry->service_us);
+  return len;
+}
+
+/**
+ * drains every ring into the log file, a buffer at a time
+ */
+static void access_log_flush(void)
+{
+  static char buf[64 * 1024];
+  int len = 0;
+
+  for (access_log_ring_t *ring = atomic_load(&rings); ring; ring = ring->next)
+  {
+    unsigned long long head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    unsigned long long tail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+    for (; head != tail; head++)
+    {
+      if (len > (int)sizeof(buf) - 8 * ACCESS_LOG_URI_MAX)
+      {
+        writen(log_fd, buf, len);
+        len = 0;
+      }
+      len += access_log_format(buf + len, &ring->entries[head % ACCESS_LOG_RING_SIZE]);
+      atomic_fetch_add_explicit(&logged, 1, memory_order_relaxed);
+    }
+    atomic_store_explicit(&ring->head, head, memory_order_release);
+  }
+  if (len > 0)
+    writen(log_fd, buf, len);
+}
+
+static void *access_log_writer(void *arg)
+{
+  while (1)
+  {
+    usleep(ACCESS_LOG_FLUSH_MS * 1000);
+    access_log_flush();
+  }
+  return NULL;
+}
+
+/**
+ * opens the log and starts the writer thread
+ *
+ * @param path the log file, appended to, or "-" for standard output
+ * @param sample log 1 in this many requests, 0 for none
+ * @return 0 on success, -1 if the file could not be opened or the thread started
+ */
+int access_log_init(const char *path, int sample)
+{
+  if (strcmp(path, "-") == 0)
+    log_fd = STDOUT_FILENO;
+  else if ((log_fd = open(path, O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644)) < 0)
+    return -1;
+  atomic_store(&sample_rate, sample);
+  pthread_key_create(&ring_key, access_log_release);
+
+  pthread_t writer;
+  if (pthread_create(&writer, NULL, access_log_writer, NULL) != 0)
+    return -1;
+  pthread_detach(writer);
+  return 0;
+}
+
+/**
+ * changes the sampling rate while the server runs
+ *
+ * @param sample log 1 in this many requests, 0 for none
+ */
+void access_log_set_sample(int sample)
+{
+  atomic_store(&sample_rate, sample);
+}
+
+/**
+ * turns logging off, or back on at the sampling rate; only touches a
+ * lock-free atomic, so it may be called from a signal handler
+ */
+void access_log_toggle(void)
+{
+  atomic_fetch_xor(&enabled, 1);
+}
+
+/**
+ * records a finished request; takes no lock and drops the entry if the
+ * writer has fallen a whole ring behind
+ *
+ * @param conn the connection, before it is handed back or closed
+ * @param wait_us time the request spent in the queue
+ * @param service_us time a worker spent on the request
+ */
+void access_log_request(conn_t *conn, long long wait_us, long long service_us)
+{
+  int sample = atomic_load_explicit(&sample_rate, memory_order_relaxed);
+  if (log_fd < 0 || sample <= 0 || !atomic_load_explicit(&enabled, memory_order_relaxed))
+    return;
+
+  access_log_ring_t *ring = access_log_ring();
+  if (!ring || ring->seen++ % sample != 0)
+    return;
+
+  unsigned long long tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+  if (tail - atomic_load_explicit(&ring->head, memory_order_acquire) >= ACCESS_LOG_RING_SIZE)
+  {
+    atomic_fetch_add_explicit(&ring->dropped, 1, memory_order_relaxed);
+    return;
+  }
+
+  struct timespec now;
+  clock_gettime(CLOCK_REALTIME, &now);
+  access_log_entry_t *entry = &ring->entries[tail % ACCESS_LOG_RING_SIZE];
+  entry->time_us = now.tv_sec * 1000000LL + now.tv_nsec / 1000;
+  entry->bytes = conn->bytes_sent;
+  entry->wait_us = wait_us;
+  entry->service_us = service_us;
+  entry->status = conn->status;
+  http_slice_copy(&conn->req.method, entry->method, sizeof(entry->method));
+  http_slice_copy(&conn->req.uri, entry->uri, sizeof(entry->uri));
+  atomic_store_explicit(&ring->tail, tail + 1, memory_order_release);
+}
+
+void access_log_stats(access_log_stats_t *stats)
+{
+  stats->logged = atomic_load(&logged);
+  stats->dropped = 0;
+  for (access_log_ring_t *ring = atomic_load(&rings); ring; ring = ring->next)
+    stats->dropped += atomic_load(&ring->dropped);
+  stats->sample = atomic_load(&enabled) ? atomic_load(&sample_rate) : 0;
+}
@@ -0,0 +1,26 @@
+#ifndef __ACCESS_LOG_H__
+#define __ACCESS_LOG_H__
+
+#include "reactor.h"
+
+// access log settings
+#define ACCESS_LOG_RING_SIZE 1024 // entries buffered per thread; a full ring drops entries
+#define ACCESS_LOG_FLUSH_MS 100   // how often the writer drains the rings
+#define ACCESS_LOG_URI_MAX 256    // longer URIs are cut short
+#define DEFAULT_ACCESS_LOG_SAMPLE 1 // log 1 in this many requests (-L), 0 for none
+
+// counters reported by the access log
+typedef struct
+{
+  long long logged;  // entries written
+  long long dropped; // entries lost to full rings
+  int sample;        // the current sampling rate, 0 while disabled
+} access_log_stats_t;
+
+int access_log_init(const char *path, int sample);
+void access_log_set_sample(int sample);
+void access_log_toggle(void);
+void access_log_request(conn_t *conn, long long wait_us, long long service_us);
+void access_log_stats(access_log_stats_t *stats);
+
+#endif // __ACCESS_LOG_H__
@@ -0,0 +1,316 @@
+#define _GNU_SOURCE
+#include "cgi_pool.h"
+#include "stats.h"
+#include <poll.h>
+#include <spawn.h>
+
+// how long a new worker has to introduce itself before the program is
+// treated as an ordinary, one-request-per-process CGI program
+#define CGI_HELLO_TIMEOUT_MS 2000
+
+int cgi_pool_size = DEFAULT_CGI_POOL_SIZE;
+int cgi_pool_max_requests = DEFAULT_CGI_POOL_MAX_REQUESTS;
+
+// the workers of one CGI program
+typedef struct cgi_program
+{
+  char filename[256];
+  int supported;             // 0 once a worker failed the handshake
+  int count;                 // live workers, busy or idle
+  cgi_proc_t *idle;          // workers waiting for a request
+  pthread_cond_t available;  // signalled when a worker becomes idle or exits
+} cgi_program_t;
+
+static cgi_program_t programs[CGI_POOL_MAX_PROGRAMS];
+static int num_programs = 0;
+static pthread_mutex_t cgi_pool_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+/**
+ * finds the pool of a CGI program, creating it on first use
+ * must be called with cgi_pool_mutex held
+ *
+ * @param filename path of the CGI program
+ * @return the program's pool, or NULL if the table is full
+ */
+static cgi_program_t *cgi_pool_lookup(const char *filename)
+{
+  for (int i = 0; i < num_programs; i++)
+  {
+    if (strcmp(programs[i].filename, filename) == 0)
+      return &programs[i];
+  }
+  if (num_programs == CGI_POOL_MAX_PROGRAMS || strlen(filename) >= sizeof(programs[0].filename))
+    return NULL;
+
+  cgi_program_t *program = &programs[num_programs++];
+  strcpy(program->filename, filename);
+  program->supported = 1;
+  program->count = 0;
+  program->idle = NULL;
+  pthread_cond_init(&program->available, NULL);
+  return program;
+}
+
+/**
+ * starts a CGI program with posix_spawn()
+ * glibc implements it with a vfork-style clone, so the cost does not grow with
+ * the size of the server's address space, and nothing runs in the child between
+ * fork and exec that would need a lock; the program's environment is built here
+ * instead of calling setenv() in the child
+ *
+ * @param filename path of the CGI program
+ * @param var "NAME=value" variable to add to (or replace in) the server's environment
+ * @param actions file descriptor set-up to perform in the child
+ * @return the child's pid, or -1 if it could not be started
+ */
+pid_t cgi_spawn(const char *filename, const char *var, const posix_spawn_file_actions_t *actions)
+{
+  extern char **environ;
+  char *argv[] = {NULL};
+  int count = 0;
+  while (environ[count])
+    count++;
+
+  char **envp = (char **)malloc((count + 2) * sizeof(char *));
+  if (!envp)
+    return -1;
+  int name_len = strchr(var, '=') - var + 1;
+  int n = 0;
+  for (int i = 0; i < count; i++)
+  {
+    if (strncmp(environ[i], var, name_len) != 0)
+      envp[n++] = environ[i];
+  }
+  envp[n++] = (char *)var;
+  envp[n] = NULL;
+
+  pid_t pid;
+  int rc = posix_spawn(&pid, filename, actions, NULL, argv, envp);
+  free(envp);
+  if (rc != 0)
+    return -1;
+  stats_count(STATS_CGI_SPAWNS, 1);
+  return pid;
+}
+
+/**
+ * starts a worker process for a program and waits for its HELLO frame
+ * the worker finds its end of the socketpair through CGI_POOL_FD
+ *
+ * @param program the program to start
+ * @return the new worker, or NULL if it could not be started or does not
+ *         speak the pool protocol
+ */
+static cgi_proc_t *cgi_pool_spawn(cgi_program_t *program)
+{
+  int sv[2];
+  if (socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, sv) < 0)
+    return NULL;
+
+  // the worker keeps its end of the socketpair across exec; pooled output
+  // travels in frames, so a program that ignores CGI_POOL_FD must not write
+  // into the server's stdout
+  char var[32];
+  posix_spawn_file_actions_t actions;
+  sprintf(var, "%s=%d", CGI_POOL_FD_ENV, sv[1]);
+  posix_spawn_file_actions_init(&actions);
+  posix_spawn_file_actions_adddup2(&actions, sv[1], sv[1]);
+  posix_spawn_file_actions_addopen(&actions, STDOUT_FILENO, "/dev/null", O_WRONLY, 0);
+  pid_t pid = cgi_spawn(program->filename, var, &actions);
+  posix_spawn_file_actions_destroy(&actions);
+  if (pid < 0)
+  {
+    close(sv[0]);
+    close(sv[1]);
+    return NULL;
+  }
+  close_or_die(sv[1]);
+
+  cgi_frame_t frame;
+  struct pollfd pfd = {sv[0], POLLIN, 0};
+  if (poll(&pfd, 1, CGI_HELLO_TIMEOUT_MS) != 1 ||
+      readn(sv[0], &frame, sizeof(frame)) != sizeof(frame) ||
+      frame.type != CGI_FRAME_HELLO || frame.len != 0)
+  {
+    close_or_die(sv[0]);
+    kill(pid, SIGKILL);
+    waitpid(pid, NULL, 0);
+    return NULL;
+  }
+
+  cgi_proc_t *proc = (cgi_proc_t *)malloc(sizeof(cgi_proc_t));
+  assert(proc != NULL);
+  proc->pid = pid;
+  proc->fd = sv[0];
+  proc->program = program;
+  proc->requests = 0;
+  proc->next = NULL;
+  return proc;
+}
+
+/**
+ * takes an idle worker for a CGI program, starting one if the pool is not full
+ * and waiting for one to become idle otherwise
+ *
+ * @param filename path of the CGI program
+ * @return a worker for the caller's exclusive use, or NULL if the request has
+ *         to run the program in a new process (pool disabled, program table
+ *         full, or the program does not support the pool protocol)
+ */
+cgi_proc_t *cgi_pool_acquire(const char *filename)
+{
+  if (cgi_pool_size <= 0)
+    return NULL;
+
+  pthread_mutex_lock(&cgi_pool_mutex);
+  cgi_program_t *program = cgi_pool_lookup(filename);
+  while (program && program->supported && !program->idle && program->count >= cgi_pool_size)
+  {
+    pthread_cond_wait(&program->available, &cgi_pool_mutex);
+  }
+  if (!program || !program->supported)
+  {
+    pthread_mutex_unlock(&cgi_pool_mutex);
+    return NULL;
+  }
+
+  cgi_proc_t *proc = program->idle;
+  if (proc)
+  {
+    program->idle = proc->next;
+    pthread_mutex_unlock(&cgi_pool_mutex);
+  }
+  else
+  {
+    // reserve a slot, then start the worker without holding the lock
+    program->count++;
+    pthread_mutex_unlock(&cgi_pool_mutex);
+
+    proc = cgi_pool_spawn(program);
+    if (!proc)
+    {
+      fprintf(stderr, "%s does not support the CGI pool, running it per request\n", filename);
+      pthread_mutex_lock(&cgi_pool_mutex);
+      program->count--;
+      program->supported = 0;
+      pthread_cond_broadcast(&program->available);
+      pthread_mutex_unlock(&cgi_pool_mutex);
+      return NULL;
+    }
+  }
+
+  proc->next = NULL;
+  proc->remaining = 0;
+  proc->done = 0;
+  proc->broken = 0;
+  return proc;
+}
+
+/**
+ * sends a request to a worker as a PARAMS frame
+ *
+ * @param proc the worker, from cgi_pool_acquire()
+ * @param query the query string, passed to the program as QUERY_STRING
+ * @return 0 on success, -1 if the worker is gone
+ */
+int cgi_pool_send(cgi_proc_t *proc, const char *query)
+{
+  static const char name[] = "QUERY_STRING=";
+  int query_len = strlen(query);
+  cgi_frame_t frame = {CGI_FRAME_PARAMS, sizeof(name) + query_len};
+
+  if (frame.len > CGI_FRAME_MAX ||
+      writen(proc->fd, &frame, sizeof(frame)) < 0 ||
+      writen(proc->fd, name, sizeof(name) - 1) < 0 ||
+      writen(proc->fd, query, query_len + 1) < 0)
+  {
+    proc->broken = 1;
+    return -1;
+  }
+  return 0;
+}
+
+/**
+ * reads the program's output for the current request, unwrapping STDOUT frames
+ * has the same contract as read(), so the response relay can treat a worker
+ * like the pipe of a freshly started CGI program
+ *
+ * @param src the worker, from cgi_pool_acquire()
+ * @param buf buffer to store the output
+ * @param count size of buf
+ * @return number of bytes read, 0 once the END frame arrived, -1 on error
+ */
+ssize_t cgi_pool_read(void *src, void *buf, size_t count)
+{
+  cgi_proc_t *proc = (cgi_proc_t *)src;
+
+  while (proc->remaining == 0)
+  {
+    cgi_frame_t frame;
+    if (proc->done)
+      return 0;
+    if (readn(proc->fd, &frame, sizeof(frame)) != sizeof(frame) ||
+        (frame.type != CGI_FRAME_STDOUT && frame.type != CGI_FRAME_END) ||
+        frame.len > CGI_FRAME_MAX || (frame.type == CGI_FRAME_END && frame.len != 0))
+    {
+      // not EINTR, which the caller would retry
+      proc->broken = 1;
+      errno = EPROTO;
+      return -1;
+    }
+    if (frame.type == CGI_FRAME_END)
+      proc->done = 1;
+    proc->remaining = frame.len;
+  }
+
+  ssize_t n;
+  do
+  {
+    n = read(proc->fd, buf, count < proc->remaining ? count : proc->remaining);
+  } while (n < 0 && errno == EINTR);
+  if (n <= 0)
+  {
+    proc->broken = 1;
+    errno = EPROTO;
+    return -1;
+  }
+  proc->remaining -= n;
+  return n;
+}
+
+/**
+ * returns a worker to its pool after a request
+ * workers that broke the protocol, did not finish their response, or reached
+ * the recycling limit (-C) are shut down instead, and their slot is refilled
+ * on demand by the next cgi_pool_acquire()
+ *
+ * @param proc the worker, from cgi_pool_acquire()
+ */
+void cgi_pool_release(cgi_proc_t *proc)
+{
+  cgi_program_t *program = proc->program;
+  proc->requests++;
+
+  if (proc->broken || !proc->done ||
+      (cgi_pool_max_requests > 0 && proc->requests >= cgi_pool_max_requests))
+  {
+    // an orderly worker exits when it sees the socket close
+    close_or_die(proc->fd);
+    if (proc->broken || !proc->done)
+      kill(proc->pid, SIGKILL);
+    waitpid(proc->pid, NULL, 0);
+    free(proc);
+
+    pthread_mutex_lock(&cgi_pool_mutex);
+    program->count--;
+    pthread_cond_signal(&program->available);
+    pthread_mutex_unlock(&cgi_pool_mutex);
+    return;
+  }
+
+  pthread_mutex_lock(&cgi_pool_mutex);
+  proc->next = program->idle;
+  program->idle = proc;
+  pthread_cond_signal(&program->available);
+  pthread_mutex_unlock(&cgi_pool_mutex);
+}
@@ -0,0 +1,38 @@
+#ifndef __CGI_POOL_H__
+#define __CGI_POOL_H__
+
+#include "io_helper.h"
+#include "cgi_worker.h"
+#include <spawn.h>
+
+// default pool settings
+#define DEFAULT_CGI_POOL_SIZE 0 // workers per CGI program, 0 runs every request in a new process
+#define DEFAULT_CGI_POOL_MAX_REQUESTS 1000
+#define CGI_POOL_MAX_PROGRAMS 16
+
+struct cgi_program;
+
+// a long-lived CGI worker process
+typedef struct cgi_proc
+{
+  pid_t pid;
+  int fd;                      // server end of the socketpair
+  struct cgi_program *program; // program this worker runs
+  int requests;                // requests served so far
+  uint32_t remaining;          // unread payload bytes of the current STDOUT frame
+  int done;                    // END frame of the current response received
+  int broken;                  // protocol error or crash, must not be reused
+  struct cgi_proc *next;       // link in the idle list
+} cgi_proc_t;
+
+// pool settings (-c and -C)
+extern int cgi_pool_size;
+extern int cgi_pool_max_requests;
+
+pid_t cgi_spawn(const char *filename, const char *var, const posix_spawn_file_actions_t *actions);
+cgi_proc_t *cgi_pool_acquire(const char *filename);
+int cgi_pool_send(cgi_proc_t *proc, const char *query);
+ssize_t cgi_pool_read(void *proc, void *buf, size_t count);
+void cgi_pool_release(cgi_proc_t *proc);
+
+#endif // __CGI_POOL_H__
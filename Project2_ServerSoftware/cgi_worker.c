@@ -0,0 +1,145 @@
+#define _GNU_SOURCE
+#include "cgi_worker.h"
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+//
+// Worker side of the CGI pool protocol (see cgi_worker.h). A CGI program
+// links this in and wraps its body in
+//
+//     while (cgi_worker_accept()) { ... }
+//
+// Started by the server as a pool worker, the loop runs once per request and
+// the process stays alive between requests. Started as a plain CGI program
+// (no CGI_POOL_FD in the environment), the loop body runs exactly once.
+//
+
+#define MODE_NEW 0
+#define MODE_CGI 1
+#define MODE_POOL 2
+
+static int mode = MODE_NEW;
+static int pool_fd = -1;
+
+static int write_all(int fd, const void *buf, size_t count)
+{
+    const char *p = buf;
+    while (count > 0)
+    {
+        ssize_t rc = write(fd, p, count);
+        if (rc < 0 && errno == EINTR)
+            continue;
+        if (rc <= 0)
+            return -1;
+        p += rc;
+        count -= rc;
+    }
+    return 0;
+}
+
+static int read_all(int fd, void *buf, size_t count)
+{
+    char *p = buf;
+    while (count > 0)
+    {
+        ssize_t rc = read(fd, p, count);
+        if (rc < 0 && errno == EINTR)
+            continue;
+        if (rc <= 0)
+            return -1;
+        p += rc;
+        count -= rc;
+    }
+    return 0;
+}
+
+static int send_frame(uint32_t type, const void *data, uint32_t len)
+{
+    cgi_frame_t frame = {type, len};
+    if (write_all(pool_fd, &frame, sizeof(frame)) < 0)
+        return -1;
+    return len > 0 ? write_all(pool_fd, data, len) : 0;
+}
+
+// stdio write hook: everything the program prints goes out as STDOUT frames
+static ssize_t pool_write(void *cookie, const char *buf, size_t size)
+{
+    size_t sent = 0;
+    while (sent < size)
+    {
+        uint32_t len = size - sent < CGI_FRAME_MAX ? size - sent : CGI_FRAME_MAX;
+        if (send_frame(CGI_FRAME_STDOUT, buf + sent, len) < 0)
+            return -1;
+        sent += len;
+    }
+    return size;
+}
+
+// reads the next PARAMS frame and installs its variables in the environment
+static int read_params(void)
+{
+    cgi_frame_t frame;
+    if (read_all(pool_fd, &frame, sizeof(frame)) < 0)
+        return -1; // server closed the socket: time to exit
+    if (frame.type != CGI_FRAME_PARAMS || frame.len > CGI_FRAME_MAX)
+        return -1;
+
+    char *params = malloc(frame.len + 1);
+    if (!params)
+        return -1;
+    if (frame.len > 0 && read_all(pool_fd, params, frame.len) < 0)
+    {
+        free(params);
+        return -1;
+    }
+    params[frame.len] = '\0';
+
+    unsetenv("QUERY_STRING");
+    for (char *p = params; p < params + frame.len; p += strlen(p) + 1)
+    {
+        char *eq = strchr(p, '=');
+        if (!eq)
+            continue;
+        *eq = '\0';
+        setenv(p, eq + 1, 1);
+    }
+    free(params);
+    return 0;
+}
+
+int cgi_worker_accept(void)
+{
+    if (mode == MODE_CGI)
+        return 0;
+
+    if (mode == MODE_NEW)
+    {
+        char *fd_env = getenv(CGI_POOL_FD_ENV);
+        if (!fd_env)
+        {
+            mode = MODE_CGI;
+            return 1;
+        }
+        mode = MODE_POOL;
+        pool_fd = atoi(fd_env);
+        unsetenv(CGI_POOL_FD_ENV);
+
+        cookie_io_functions_t io = {NULL, pool_write, NULL, NULL};
+        FILE *out = fopencookie(NULL, "w", io);
+        if (!out || send_frame(CGI_FRAME_HELLO, NULL, 0) < 0)
+            return 0;
+        stdout = out;
+    }
+    else
+    {
+        // the previous request is done
+        fflush(stdout);
+        if (send_frame(CGI_FRAME_END, NULL, 0) < 0)
+            return 0;
+    }
+
+    return read_params() == 0;
+}
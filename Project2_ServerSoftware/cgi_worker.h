@@ -0,0 +1,36 @@
+#ifndef __CGI_WORKER_H__
+#define __CGI_WORKER_H__
+
+#include <stdint.h>
+
+//
+// Protocol between wserver and a pooled CGI worker process, modeled on FastCGI.
+// Every message is a frame: an 8 byte header followed by len bytes of payload,
+// sent over the UNIX socket named by the CGI_POOL_FD environment variable.
+//
+//   worker -> server  CGI_FRAME_HELLO   once at startup, empty
+//   server -> worker  CGI_FRAME_PARAMS  one per request, "NAME=value\0" pairs
+//   worker -> server  CGI_FRAME_STDOUT  any number per request, program output
+//   worker -> server  CGI_FRAME_END     ends the response, empty
+//
+#define CGI_POOL_FD_ENV "CGI_POOL_FD"
+
+#define CGI_FRAME_HELLO 1
+#define CGI_FRAME_PARAMS 2
+#define CGI_FRAME_STDOUT 3
+#define CGI_FRAME_END 4
+
+// largest payload of a single frame
+#define CGI_FRAME_MAX (64 * 1024)
+
+typedef struct
+{
+    uint32_t type;
+    uint32_t len;
+} cgi_frame_t;
+
+// worker side: returns 1 when a request is ready to be served (QUERY_STRING
+// set, stdout routed to the server) and 0 when the program should exit
+int cgi_worker_accept(void);
+
+#endif // __CGI_WORKER_H__
@@ -0,0 +1,96 @@
+#include "codel.h"
+
+void codel_init(codel_t *c, int target_ms, int interval_ms)
+{
+  pthread_mutex_init(&c->mutex, NULL);
+  c->target_us = target_ms * 1000LL;
+  c->interval_us = interval_ms * 1000LL;
+  c->first_above_us = 0;
+  c->drop_next_us = 0;
+  c->dropping = 0;
+  c->count = 0;
+  c->shed = 0;
+}
+
+/**
+ * integer square root, for the control law without linking libm
+ */
+static long long codel_isqrt(long long n)
+{
+  long long r = 0;
+  while ((r + 1) * (r + 1) <= n)
+    r++;
+  return r;
+}
+
+/**
+ * when to shed the next request: the gap shrinks with the square root of
+ * the number shed so far, so shedding grows until the wait falls back
+ */
+static long long codel_control_law(codel_t *c, long long t)
+{
+  return t + c->interval_us / codel_isqrt(c->count > 0 ? c->count : 1);
+}
+
+/**
+ * tells whether the wait has stayed above target for a whole interval
+ */
+static int codel_ok_to_drop(codel_t *c, long long wait_us, long long now)
+{
+  if (wait_us < c->target_us)
+  {
+    c->first_above_us = 0;
+    return 0;
+  }
+  if (c->first_above_us == 0)
+  {
+    c->first_above_us = now + c->interval_us;
+    return 0;
+  }
+  return now >= c->first_above_us;
+}
+
+/**
+ * decides whether a request just taken from the queue should be shed
+ * this is the CoDel dequeue rule: a short burst that queues requests for less
+ * than an interval is absorbed, but once even the shortest wait stays above
+ * target for an interval, requests are shed at an increasing rate until a
+ * request is again taken within target
+ *
+ * @param c the CoDel state
+ * @param wait_us how long the request waited in the queue
+ * @param now the current monotonic time in microseconds
+ * @return 1 if the request should be answered with 503, 0 to serve it
+ */
+int codel_should_drop(codel_t *c, long long wait_us, long long now)
+{
+  int drop = 0;
+
+  pthread_mutex_lock(&c->mutex);
+  int ok_to_drop = codel_ok_to_drop(c, wait_us, now);
+  if (c->dropping)
+  {
+    if (!ok_to_drop)
+    {
+      c->dropping = 0;
+    }
+    else if (now >= c->drop_next_us)
+    {
+      drop = 1;
+      c->count++;
+      c->drop_next_us = codel_control_law(c, c->drop_next_us);
+    }
+  }
+  else if (ok_to_drop)
+  {
+    drop = 1;
+    c->dropping = 1;
+    // resume near the previous rate if the last dropping spell ended recently
+    c->count = c->count > 2 && now - c->drop_next_us < 16 * c->interval_us ? c->count - 2 : 1;
+    c->drop_next_us = codel_control_law(c, now);
+  }
+  if (drop)
+    c->shed++;
+  pthread_mutex_unlock(&c->mutex);
+  return drop;
+}
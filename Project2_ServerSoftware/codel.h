@@ -0,0 +1,27 @@
+#ifndef __CODEL_H__
+#define __CODEL_H__
+
+#include <pthread.h>
+
+// default CoDel settings
+#define DEFAULT_CODEL_TARGET_MS 100    // queue wait that is acceptable to persist (-T)
+#define DEFAULT_CODEL_INTERVAL_MS 1000 // how long the wait may stay above target before shedding starts
+
+// Controlled Delay (CoDel) state, shared by every worker that takes requests
+// from the queues it watches
+typedef struct
+{
+  pthread_mutex_t mutex;
+  long long target_us;
+  long long interval_us;
+  long long first_above_us; // when the wait will have stayed above target for an interval, 0 if below
+  long long drop_next_us;   // when the next request is shed while dropping
+  int dropping;             // the queue is overloaded and requests are being shed
+  int count;                // requests shed since dropping started
+  long long shed;           // requests shed since startup
+} codel_t;
+
+void codel_init(codel_t *c, int target_ms, int interval_ms);
+int codel_should_drop(codel_t *c, long long wait_us, long long now);
+
+#endif // __CODEL_H__
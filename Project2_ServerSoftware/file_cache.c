@@ -0,0 +1,304 @@
+#include "file_cache.h"
+
+#define FILE_CACHE_BUCKETS 64 // hash chains per shard
+
+// one independently locked part of the cache
+typedef struct
+{
+  pthread_mutex_t mutex;
+  file_entry_t *buckets[FILE_CACHE_BUCKETS];
+  file_entry_t *head, *tail; // LRU list, most recently used first
+  int count;
+  int capacity;
+} file_shard_t;
+
+int file_cache_entries = DEFAULT_FILE_CACHE_ENTRIES;
+
+static file_shard_t shards[FILE_CACHE_SHARDS];
+
+/**
+ * FNV-1a hash of a path, picks the shard and the hash chain
+ */
+static unsigned int file_hash(const char *path)
+{
+  unsigned int hash = 2166136261u;
+  for (const unsigned char *p = (const unsigned char *)path; *p; p++)
+  {
+    hash ^= *p;
+    hash *= 16777619u;
+  }
+  return hash;
+}
+
+/**
+ * fills in the MIME type given the filename
+ */
+static void file_get_type(const char *filename, char *filetype)
+{
+  if (strstr(filename, ".html"))
+    strcpy(filetype, "text/html");
+  else if (strstr(filename, ".gif"))
+    strcpy(filetype, "image/gif");
+  else if (strstr(filename, ".jpg"))
+    strcpy(filetype, "image/jpeg");
+  else
+    strcpy(filetype, "text/plain");
+}
+
+static void file_free(file_entry_t *entry)
+{
+  if (entry->fd >= 0)
+    close_or_die(entry->fd);
+  free(entry->body);
+  free(entry);
+}
+
+/**
+ * opens a file and prepares everything needed to send it
+ * files up to FILE_CACHE_BODY_MAX are read into memory and closed; larger
+ * files keep their descriptor open for sendfile()
+ *
+ * @param path path of the file
+ * @param hash file_hash() of path
+ * @return a new entry with one reference, or NULL with errno set (ENOENT and
+ *         ENOTDIR for a missing file, EACCES for one that may not be served)
+ */
+static file_entry_t *file_load(const char *path, unsigned int hash)
+{
+  struct stat sbuf;
+  char filetype[64];
+
+  if (strlen(path) >= sizeof(((file_entry_t *)0)->path))
+  {
+    errno = ENAMETOOLONG;
+    return NULL;
+  }
+  int fd = open(path, O_RDONLY | O_CLOEXEC);
+  if (fd < 0)
+    return NULL;
+  if (fstat(fd, &sbuf) < 0 || !S_ISREG(sbuf.st_mode) || !(S_IRUSR & sbuf.st_mode))
+  {
+    close_or_die(fd);
+    errno = EACCES;
+    return NULL;
+  }
+
+  file_entry_t *entry = (file_entry_t *)calloc(1, sizeof(file_entry_t));
+  assert(entry != NULL);
+  strcpy(entry->path, path);
+  entry->hash = hash;
+  entry->fd = fd;
+  entry->size = sbuf.st_size;
+  entry->mtime = sbuf.st_mtim;
+  entry->ino = sbuf.st_ino;
+  entry->checked = now_usec();
+  entry->refs = 1;
+
+  file_get_type(path, filetype);
+  entry->header_len = snprintf(entry->header, sizeof(entry->header), ""
+                                                                     "HTTP/1.1 200 OK\r\n"
+                                                                     "Server: OSTEP WebServer\r\n"
+                                                                     "Content-Length: %lld\r\n"
+                                                                     "Content-Type: %s\r\n",
+                               (long long)entry->size, filetype);
+
+  if (entry->size <= FILE_CACHE_BODY_MAX)
+  {
+    entry->body = (char *)malloc(entry->size > 0 ? entry->size : 1);
+    assert(entry->body != NULL);
+    if (readn(fd, entry->body, entry->size) != entry->size)
+    {
+      file_free(entry);
+      errno = EIO;
+      return NULL;
+    }
+    close_or_die(fd);
+    entry->fd = -1;
+  }
+  return entry;
+}
+
+/**
+ * finds a cached entry; must be called with the shard's mutex held
+ */
+static file_entry_t *shard_find(file_shard_t *shard, const char *path, unsigned int hash)
+{
+  file_entry_t *entry = shard->buckets[hash / FILE_CACHE_SHARDS % FILE_CACHE_BUCKETS];
+  while (entry && (entry->hash != hash || strcmp(entry->path, path) != 0))
+    entry = entry->hnext;
+  return entry;
+}
+
+/**
+ * moves an entry to the front of the LRU list, unlinking it first if linked
+ */
+static void shard_touch(file_shard_t *shard, file_entry_t *entry, int linked)
+{
+  if (linked)
+  {
+    if (shard->head == entry)
+      return;
+    entry->prev->next = entry->next;
+    if (entry->next)
+      entry->next->prev = entry->prev;
+    else
+      shard->tail = entry->prev;
+  }
+  entry->prev = NULL;
+  entry->next = shard->head;
+  if (shard->head)
+    shard->head->prev = entry;
+  else
+    shard->tail = entry;
+  shard->head = entry;
+}
+
+/**
+ * removes an entry from the shard and drops the cache's reference to it
+ * the entry is freed here unless a request is still sending it
+ */
+static void shard_remove(file_shard_t *shard, file_entry_t *entry)
+{
+  file_entry_t **link = &shard->buckets[entry->hash / FILE_CACHE_SHARDS % FILE_CACHE_BUCKETS];
+  while (*link != entry)
+    link = &(*link)->hnext;
+  *link = entry->hnext;
+
+  if (entry->prev)
+    entry->prev->next = entry->next;
+  else
+    shard->head = entry->next;
+  if (entry->next)
+    entry->next->prev = entry->prev;
+  else
+    shard->tail = entry->prev;
+
+  shard->count--;
+  if (--entry->refs == 0)
+    file_free(entry);
+}
+
+/**
+ * adds an entry to the shard, replacing any entry for the same path and
+ * evicting the least recently used entries beyond the shard's capacity
+ */
+static void shard_insert(file_shard_t *shard, file_entry_t *entry)
+{
+  file_entry_t *old = shard_find(shard, entry->path, entry->hash);
+  if (old)
+    shard_remove(shard, old);
+
+  file_entry_t **bucket = &shard->buckets[entry->hash / FILE_CACHE_SHARDS % FILE_CACHE_BUCKETS];
+  entry->hnext = *bucket;
+  *bucket = entry;
+  shard_touch(shard, entry, 0);
+  entry->refs++;
+  shard->count++;
+
+  while (shard->count > shard->capacity)
+    shard_remove(shard, shard->tail);
+}
+
+/**
+ * initializes the shards, splitting -f entries between them
+ */
+void file_cache_init(void)
+{
+  int capacity = (file_cache_entries + FILE_CACHE_SHARDS - 1) / FILE_CACHE_SHARDS;
+  for (int i = 0; i < FILE_CACHE_SHARDS; i++)
+  {
+    pthread_mutex_init(&shards[i].mutex, NULL);
+    shards[i].capacity = capacity;
+  }
+}
+
+/**
+ * looks up a static file, loading it on a miss
+ * a hit touches the filesystem only once per FILE_CACHE_REVALIDATE_MS, when one
+ * request stat()s the file to check that its size, mtime and inode are
+ * unchanged; a changed file is loaded again and replaces the old entry, which
+ * requests still sending it keep alive until they call file_cache_put()
+ *
+ * @param path path of the file
+ * @param entry the entry to send, valid until file_cache_put()
+ * @return 0 on success, or -1 with errno set as by file_load()
+ */
+int file_cache_get(const char *path, file_entry_t **entry)
+{
+  unsigned int hash = file_hash(path);
+  file_shard_t *shard = &shards[hash % FILE_CACHE_SHARDS];
+  file_entry_t *found = NULL;
+  int revalidate = 0;
+
+  if (shard->capacity > 0)
+  {
+    long long now = now_usec();
+    pthread_mutex_lock(&shard->mutex);
+    found = shard_find(shard, path, hash);
+    if (found)
+    {
+      shard_touch(shard, found, 1);
+      found->refs++;
+      if (now - found->checked >= FILE_CACHE_REVALIDATE_MS * 1000LL)
+      {
+        // this request checks; concurrent hits keep using the entry meanwhile
+        found->checked = now;
+        revalidate = 1;
+      }
+    }
+    pthread_mutex_unlock(&shard->mutex);
+  }
+
+  if (found)
+  {
+    struct stat sbuf;
+    if (!revalidate ||
+        (stat(path, &sbuf) == 0 && sbuf.st_size == found->size && sbuf.st_ino == found->ino &&
+         sbuf.st_mtim.tv_sec == found->mtime.tv_sec && sbuf.st_mtim.tv_nsec == found->mtime.tv_nsec &&
+         (S_IRUSR & sbuf.st_mode)))
+    {
+      *entry = found;
+      return 0;
+    }
+    file_cache_put(found);
+  }
+
+  file_entry_t *loaded = file_load(path, hash);
+  if (!loaded)
+  {
+    if (found)
+    {
+      int saved_errno = errno;
+      pthread_mutex_lock(&shard->mutex);
+      if (shard_find(shard, path, hash) == found)
+        shard_remove(shard, found);
+      pthread_mutex_unlock(&shard->mutex);
+      errno = saved_errno;
+    }
+    return -1;
+  }
+
+  if (shard->capacity > 0)
+  {
+    pthread_mutex_lock(&shard->mutex);
+    shard_insert(shard, loaded);
+    pthread_mutex_unlock(&shard->mutex);
+  }
+  *entry = loaded;
+  return 0;
+}
+
+/**
+ * releases an entry returned by file_cache_get()
+ *
+ * @param entry the entry, which must not be used afterwards
+ */
+void file_cache_put(file_entry_t *entry)
+{
+  file_shard_t *shard = &shards[entry->hash % FILE_CACHE_SHARDS];
+  pthread_mutex_lock(&shard->mutex);
+  int unused = --entry->refs == 0;
+  pthread_mutex_unlock(&shard->mutex);
+  if (unused)
+    file_free(entry);
+}
@@ -0,0 +1,37 @@
+#ifndef __FILE_CACHE_H__
+#define __FILE_CACHE_H__
+
+#include "io_helper.h"
+
+// default cache settings
+#define DEFAULT_FILE_CACHE_ENTRIES 256   // files cached across all shards, 0 disables the cache
+#define FILE_CACHE_SHARDS 16             // independently locked parts of the cache
+#define FILE_CACHE_BODY_MAX (64 * 1024)  // files up to this size are kept in memory
+#define FILE_CACHE_REVALIDATE_MS 1000    // how long an entry is trusted before its mtime is checked again
+
+// a static file with everything needed to send it
+typedef struct file_entry
+{
+  char path[256];
+  unsigned int hash;
+  int fd;                     // open file, -1 if the body is cached
+  off_t size;
+  struct timespec mtime;      // with ino, detects a changed or replaced file
+  ino_t ino;
+  char *body;                 // file contents for small files, NULL otherwise
+  char header[256];           // prebuilt status line and headers, without Connection and the blank line
+  int header_len;
+  long long checked;          // monotonic time of the last stat(), in microseconds
+  int refs;                   // requests using the entry, plus one while it is in the cache
+  struct file_entry *hnext;   // hash chain within the shard
+  struct file_entry *prev, *next; // LRU list within the shard, most recently used first
+} file_entry_t;
+
+// cache setting (-f)
+extern int file_cache_entries;
+
+void file_cache_init(void);
+int file_cache_get(const char *path, file_entry_t **entry);
+void file_cache_put(file_entry_t *entry);
+
+#endif // __FILE_CACHE_H__
@@ -0,0 +1,202 @@
+#include "http.h"
+#include <string.h>
+#include <strings.h>
+
+/**
+ * looks for the blank line that terminates a block of headers
+ * only the bytes from old_len on (plus a few bytes of overlap) are scanned, so
+ * a request trickling in one byte at a time is still examined in linear time
+ * accepts both "\r\n\r\n" and bare "\n\n" line endings, as wclient sends the latter
+ *
+ * @param buf the buffer to search
+ * @param len number of valid bytes in buf
+ * @param old_len number of bytes that were already searched on a previous call
+ * @return length of the headers including the blank line, or 0 if not yet complete
+ */
+int find_header_end(const char *buf, int len, int old_len)
+{
+  int start = old_len > 3 ? old_len - 3 : 0;
+
+  for (int i = start; i < len; i++)
+  {
+    if (buf[i] != '\n')
+      continue;
+    if (i + 1 < len && buf[i + 1] == '\n')
+      return i + 2;
+    if (i + 2 < len && buf[i + 1] == '\r' && buf[i + 2] == '\n')
+      return i + 3;
+  }
+  return 0;
+}
+
+/**
+ * returns the length of the line starting at p, excluding its "\r\n" or "\n"
+ * and stores the offset of the following line in *next
+ */
+static int http_line(const char *buf, int len, int p, int *next)
+{
+  int end = p;
+  while (end < len && buf[end] != '\n')
+    end++;
+  *next = end < len ? end + 1 : len;
+  if (end > p && buf[end - 1] == '\r')
+    end--;
+  return end - p;
+}
+
+/**
+ * cuts the next space separated token off the front of [*p, end)
+ */
+static void http_token(const char *buf, int *p, int end, http_slice_t *token)
+{
+  while (*p < end && buf[*p] == ' ')
+    (*p)++;
+  token->ptr = buf + *p;
+  while (*p < end && buf[*p] != ' ')
+    (*p)++;
+  token->len = buf + *p - token->ptr;
+}
+
+/**
+ * parses an HTTP request line and its headers in a single pass over the buffer
+ * nothing is copied: the method, URI, path, query, version and every header
+ * name and value are returned as slices pointing into buf
+ * headers beyond HTTP_MAX_HEADERS are skipped
+ *
+ * @param buf the receive buffer holding the request
+ * @param len number of valid bytes in buf
+ * @param req the parsed request
+ * @return number of bytes the request line and headers occupy, 0 if the
+ *         headers are not complete yet, or -1 if the request line is malformed
+ */
+int http_parse_request(const char *buf, int len, http_request_t *req)
+{
+  int p = 0, next;
+
+  memset(req, 0, sizeof(*req));
+
+  // skip empty lines in front of the request line
+  int line_len = http_line(buf, len, p, &next);
+  while (line_len == 0 && next < len)
+  {
+    p = next;
+    line_len = http_line(buf, len, p, &next);
+  }
+  if (next == len && (len == 0 || buf[len - 1] != '\n'))
+    return 0;
+
+  // request line: method, target, version
+  int end = p + line_len;
+  http_token(buf, &p, end, &req->method);
+  http_token(buf, &p, end, &req->uri);
+  http_token(buf, &p, end, &req->version);
+  if (req->method.len == 0 || req->uri.len == 0)
+    return -1;
+
+  req->path = req->uri;
+  const char *q = memchr(req->uri.ptr, '?', req->uri.len);
+  if (q)
+  {
+    req->path.len = q - req->uri.ptr;
+    req->query.ptr = q + 1;
+    req->query.len = req->uri.len - req->path.len - 1;
+  }
+  else
+  {
+    req->query.ptr = req->uri.ptr + req->uri.len;
+  }
+
+  // headers, up to the blank line
+  p = next;
+  while (p < len)
+  {
+    line_len = http_line(buf, len, p, &next);
+    if (next == len && buf[len - 1] != '\n')
+      return 0;
+    if (line_len == 0)
+    {
+      req->header_len = next;
+      return next;
+    }
+
+    const char *colon = memchr(buf + p, ':', line_len);
+    if (colon && req->num_headers < HTTP_MAX_HEADERS)
+    {
+      http_header_t *h = &req->headers[req->num_headers++];
+      h->name.ptr = buf + p;
+      h->name.len = colon - h->name.ptr;
+      const char *v = colon + 1, *v_end = buf + p + line_len;
+      while (v < v_end && (*v == ' ' || *v == '\t'))
+        v++;
+      while (v_end > v && (v_end[-1] == ' ' || v_end[-1] == '\t'))
+        v_end--;
+      h->value.ptr = v;
+      h->value.len = v_end - v;
+    }
+    p = next;
+  }
+  return 0;
+}
+
+/**
+ * finds a header by name (case-insensitive)
+ *
+ * @param req the parsed request
+ * @param name header name, without the colon
+ * @return the header value, or NULL if the request has no such header
+ */
+const http_slice_t *http_get_header(const http_request_t *req, const char *name)
+{
+  int name_len = strlen(name);
+  for (int i = 0; i < req->num_headers; i++)
+  {
+    const http_header_t *h = &req->headers[i];
+    if (h->name.len == name_len && strncasecmp(h->name.ptr, name, name_len) == 0)
+      return &h->value;
+  }
+  return NULL;
+}
+
+/**
+ * compares a slice with a string, ignoring case
+ *
+ * @return 1 if they are equal, 0 otherwise
+ */
+int http_slice_equals(const http_slice_t *slice, const char *str)
+{
+  int len = strlen(str);
+  return slice->len == len && strncasecmp(slice->ptr, str, len) == 0;
+}
+
+/**
+ * tells whether a slice contains a string, ignoring case
+ * used for comma separated header values such as "Connection: keep-alive, Upgrade"
+ *
+ * @return 1 if str occurs in the slice, 0 otherwise
+ */
+int http_slice_contains(const http_slice_t *slice, const char *str)
+{
+  int len = strlen(str);
+  for (int i = 0; i + len <= slice->len; i++)
+  {
+    if (strncasecmp(slice->ptr + i, str, len) == 0)
+      return 1;
+  }
+  return 0;
+}
+
+/**
+ * copies a slice into a NUL terminated string, truncating it to fit
+ *
+ * @param slice the slice to copy
+ * @param buf destination buffer
+ * @param size size of buf in bytes
+ * @return number of characters copied
+ */
+int http_slice_copy(const http_slice_t *slice, char *buf, int size)
+{
+  int n = slice->len < size - 1 ? slice->len : size - 1;
+  memcpy(buf, slice->ptr, n);
+  buf[n] = '\0';
+  return n;
+}
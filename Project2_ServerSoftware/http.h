@@ -0,0 +1,40 @@
+#ifndef __HTTP_H__
+#define __HTTP_H__
+
+#define HTTP_MAX_HEADERS 32
+
+// a piece of the receive buffer; not NUL terminated
+typedef struct
+{
+  const char *ptr;
+  int len;
+} http_slice_t;
+
+typedef struct
+{
+  http_slice_t name;
+  http_slice_t value;
+} http_header_t;
+
+// a parsed request; every slice points into the connection's receive buffer,
+// so it stays valid only until that buffer is reused for the next request
+typedef struct
+{
+  http_slice_t method;
+  http_slice_t uri;     // full request target
+  http_slice_t path;    // request target up to '?'
+  http_slice_t query;   // request target after '?', empty if none
+  http_slice_t version; // empty for a bare "GET /path" request line
+  int num_headers;
+  http_header_t headers[HTTP_MAX_HEADERS];
+  int header_len; // bytes taken by the request line, headers and blank line
+} http_request_t;
+
+int find_header_end(const char *buf, int len, int old_len);
+int http_parse_request(const char *buf, int len, http_request_t *req);
+const http_slice_t *http_get_header(const http_request_t *req, const char *name);
+int http_slice_equals(const http_slice_t *slice, const char *str);
+int http_slice_contains(const http_slice_t *slice, const char *str);
+int http_slice_copy(const http_slice_t *slice, char *buf, int size);
+
+#endif // __HTTP_H__
@@ -61,6 +61,177 @@ ssize_t readline(int fd, void *buf, size_t maxlen)
     return n;
 }
 
+/**
+ * writes exactly count bytes to a file descriptor
+ * keeps writing after partial writes and interrupted calls; unlike write_or_die()
+ * a failure (e.g. the client closed its end) is reported instead of aborting
+ *
+ * @param fd file descriptor to write to
+ * @param buf data to write
+ * @param count number of bytes to write
+ * @return count on success, or -1 on error
+ */
+ssize_t writen(int fd, const void *buf, size_t count)
+{
+    const char *p = buf;
+    size_t left = count;
+    while (left > 0)
+    {
+        ssize_t rc = write(fd, p, left);
+        if (rc < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            return -1;
+        }
+        p += rc;
+        left -= rc;
+    }
+    return count;
+}
+
+/**
+ * sends exactly count bytes on a socket with the given send() flags
+ * like writen(), but with MSG_MORE the kernel holds the bytes back until the
+ * data that follows (e.g. a sendfile() body) fills the packet
+ *
+ * @param fd socket to send on
+ * @param buf data to send
+ * @param count number of bytes to send
+ * @param flags flags for send(), e.g. MSG_MORE
+ * @return count on success, or -1 on error
+ */
+ssize_t sendn(int fd, const void *buf, size_t count, int flags)
+{
+    const char *p = buf;
+    size_t left = count;
+    while (left > 0)
+    {
+        ssize_t rc = send(fd, p, left, flags);
+        if (rc < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            return -1;
+        }
+        p += rc;
+        left -= rc;
+    }
+    return count;
+}
+
+/**
+ * writes all the buffers of an I/O vector with as few writev() calls as possible
+ * after a partial write the vector is advanced past the bytes already written,
+ * so the caller's iov array is modified
+ *
+ * @param fd file descriptor to write to
+ * @param iov buffers to write
+ * @param iovcnt number of buffers
+ * @return total number of bytes written, or -1 on error
+ */
+ssize_t writevn(int fd, struct iovec *iov, int iovcnt)
+{
+    ssize_t total = 0;
+    while (iovcnt > 0)
+    {
+        ssize_t rc = writev(fd, iov, iovcnt);
+        if (rc < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            return -1;
+        }
+        total += rc;
+        while (iovcnt > 0 && (size_t)rc >= iov->iov_len)
+        {
+            rc -= iov->iov_len;
+            iov++;
+            iovcnt--;
+        }
+        if (iovcnt > 0)
+        {
+            iov->iov_base = (char *)iov->iov_base + rc;
+            iov->iov_len -= rc;
+        }
+    }
+    return total;
+}
+
+/**
+ * copies count bytes of a file to a socket inside the kernel with sendfile()
+ * the file is never mapped or copied into user space, and partial transfers are
+ * resumed until the whole range has been sent
+ *
+ * @param out_fd socket to send to
+ * @param in_fd file to send from
+ * @param offset position in the file to start at
+ * @param count number of bytes to send
+ * @return count on success, or -1 on error (including the file shrinking)
+ */
+ssize_t sendfilen(int out_fd, int in_fd, off_t offset, size_t count)
+{
+    size_t left = count;
+    while (left > 0)
+    {
+        ssize_t rc = sendfile(out_fd, in_fd, &offset, left);
+        if (rc < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            return -1;
+        }
+        if (rc == 0)
+            return -1;
+        left -= rc;
+    }
+    return count;
+}
+
+/**
+ * reads exactly count bytes from a file descriptor
+ * keeps reading after short reads and interrupted calls, stopping early only
+ * at end of file
+ *
+ * @param fd file descriptor to read from
+ * @param buf buffer to store the data
+ * @param count number of bytes to read
+ * @return number of bytes read (less than count only at end of file), or -1 on error
+ */
+ssize_t readn(int fd, void *buf, size_t count)
+{
+    char *p = buf;
+    size_t left = count;
+    while (left > 0)
+    {
+        ssize_t rc = read(fd, p, left);
+        if (rc < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            return -1;
+        }
+        if (rc == 0)
+            break;
+        p += rc;
+        left -= rc;
+    }
+    return count - left;
+}
+
+/**
+ * returns the current time of the monotonic clock
+ * used for timeouts and latency measurements, which must not jump with wall-clock changes
+ *
+ * @return monotonic time in microseconds
+ */
+long long now_usec(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
 /**
  * opens client socket connection to a specified server
  * creates socket and establishes a connection to the server at the given hostname and port
@@ -109,15 +280,17 @@ int open_client_fd(char *hostname, int port)
  * creates a socket to listen for incoming client connections
  * creates and configures a socket with the specified port, sets socket options to allow
  * address reuse, binds to the specified port on all network interfaces, and
- * prepares the socket to accept connections
+ * prepares the socket to accept connections; the socket is close-on-exec so that
+ * CGI programs do not inherit it
  *
  * @param port port number to listen on
+ * @param reuseport set SO_REUSEPORT so several sockets can listen on the port
  * @return listening socket file descriptor or -1 on error
  */
-int open_listen_fd(int port)
+static int open_listen_socket(int port, int reuseport)
 {
     int listen_fd;
-    if ((listen_fd = socket(AF_INET, SOCK_STREAM, 0)) < 0)
+    if ((listen_fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0)) < 0)
     {
         fprintf(stderr, "socket() failed\n");
         return -1;
@@ -130,6 +303,11 @@ int open_listen_fd(int port)
         fprintf(stderr, "setsockopt() failed\n");
         return -1;
     }
+    if (reuseport && setsockopt(listen_fd, SOL_SOCKET, SO_REUSEPORT, (const void *)&optval, sizeof(int)) < 0)
+    {
+        fprintf(stderr, "setsockopt(SO_REUSEPORT) failed\n");
+        return -1;
+    }
 
     struct sockaddr_in server_addr;
     bzero((char *)&server_addr, sizeof(server_addr));
@@ -150,76 +328,16 @@ int open_listen_fd(int port)
     return listen_fd;
 }
 
-/**
- * gets the size of a file specified by filename
- * uses the stat system call to retrieve file information and returns the file size
- *
- * @param filename path to the file whose size is to be determined
- * @return size of the file in bytes, or 0 if the file cannot be accessed
- */
-int get_file_size(char *filename)
+int open_listen_fd(int port)
 {
-    struct stat st;
-    if (stat(filename, &st) == 0)
-    {
-        return st.st_size;
-    }
-    return 0; // return 0 if can't determine size
+    return open_listen_socket(port, 0);
 }
 
 /**
- * estimates the size of an HTTP request by examining the request headers
- * peeks at the request data without consuming it, extracts the URI, and
- * either uses special handling for CGI scripts with 'spin' parameters or
- * determines the actual file size for static files
- *
- * @param fd client socket file descriptor to examine
- * @return estimated size in bytes of the requested resource
+ * creates one of several sockets listening on the same port; the kernel
+ * spreads new connections across them by a hash of the client's address
  */
-int estimate_request_size(int fd)
+int open_listen_fd_reuseport(int port)
 {
-    char buf[8192];
-    int n = recv(fd, buf, sizeof(buf) - 1, MSG_PEEK);
-    if (n <= 0)
-        return 0;
-
-    buf[n] = '\0';
-
-    // look for request URI
-    char *uri_start = strstr(buf, "GET ");
-    if (!uri_start)
-        return n;
-
-    uri_start += 4; // skip "GET "
-    char *uri_end = strchr(uri_start, ' ');
-    if (!uri_end)
-        return n;
-
-    int uri_len = uri_end - uri_start;
-    char uri[1024];
-    if (uri_len >= sizeof(uri))
-        uri_len = sizeof(uri) - 1;
-    strncpy(uri, uri_start, uri_len);
-    uri[uri_len] = '\0';
-
-    // if it's a CGI script with spin parameter, use that as a proxy for file size
-    if (strstr(uri, "spin.cgi?"))
-    {
-        char *param = strchr(uri, '?');
-        if (param)
-        {
-            int spin_time = atoi(param + 1);
-            return spin_time * 1000; // scale up
-        }
-    }
-
-    // for static files, extract the filename and get its actual size
-    char filename[1024];
-    sprintf(filename, ".%s", uri);
-    if (uri[strlen(uri) - 1] == '/')
-    {
-        strcat(filename, "index.html");
-    }
-
-    return get_file_size(filename);
+    return open_listen_socket(port, 1);
 }
\ No newline at end of file
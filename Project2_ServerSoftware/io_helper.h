@@ -15,10 +15,13 @@
 #include <string.h>
 #include <strings.h>
 #include <sys/mman.h>
+#include <sys/sendfile.h>
 #include <sys/time.h>
+#include <time.h>
 #include <sys/socket.h>
 #include <sys/stat.h>
 #include <sys/types.h>
+#include <sys/uio.h>
 #include <sys/wait.h>
 #include <unistd.h>
 #include <pthread.h>
@@ -95,8 +98,15 @@ void io_helper_cleanup(void);
 
 // client/server helper functions
 ssize_t readline(int fd, void *buf, size_t maxlen);
+ssize_t readn(int fd, void *buf, size_t count);
+ssize_t writen(int fd, const void *buf, size_t count);
+ssize_t sendn(int fd, const void *buf, size_t count, int flags);
+ssize_t writevn(int fd, struct iovec *iov, int iovcnt);
+ssize_t sendfilen(int out_fd, int in_fd, off_t offset, size_t count);
+long long now_usec(void);
 int open_client_fd(char *hostname, int portno);
 int open_listen_fd(int portno);
+int open_listen_fd_reuseport(int portno);
 
 // wrappers for above
 #define readline_or_die(fd, buf, maxlen) \
@@ -105,5 +115,7 @@ int open_listen_fd(int portno);
     ({ int rc = open_client_fd(hostname, port); assert(rc >= 0); rc; })
 #define open_listen_fd_or_die(port) \
     ({ int rc = open_listen_fd(port); assert(rc >= 0); rc; })
+#define open_listen_fd_reuseport_or_die(port) \
+    ({ int rc = open_listen_fd_reuseport(port); assert(rc >= 0); rc; })
 
 #endif // __IO_HELPER__
@@ -0,0 +1,209 @@
+#include "mpmc.h"
+#include <errno.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+#include <linux/futex.h>
+#include <sys/syscall.h>
+
+/**
+ * initializes an empty ring
+ * any capacity works, including 1: positions are mapped to slots with a modulo,
+ * and sequence numbers count in steps of two (2 * pos free, 2 * pos + 1 full) so
+ * a full slot can never be mistaken for a free one of the next lap
+ *
+ * @param ring the ring to initialize
+ * @param capacity maximum number of items in the ring
+ * @return 0 on success, -1 if the slots could not be allocated
+ */
+int mpmc_ring_init(mpmc_ring_t *ring, size_t capacity)
+{
+  ring->slots = (mpmc_slot_t *)malloc(capacity * sizeof(mpmc_slot_t));
+  if (!ring->slots)
+    return -1;
+  ring->capacity = capacity;
+  for (size_t i = 0; i < capacity; i++)
+    atomic_init(&ring->slots[i].seq, 2 * i);
+  atomic_init(&ring->head, 0);
+  atomic_init(&ring->tail, 0);
+  return 0;
+}
+
+/**
+ * adds an item without blocking
+ * a slot at position pos is free for the producer when its sequence number
+ * equals 2 * pos; the producer claims pos by advancing head with a CAS, stores
+ * the item and publishes it by setting the sequence number to 2 * pos + 1
+ *
+ * @param ring the ring
+ * @param item the item to add
+ * @return 0 on success, -1 if the ring is full
+ */
+int mpmc_ring_push(mpmc_ring_t *ring, void *item)
+{
+  size_t pos = atomic_load_explicit(&ring->head, memory_order_relaxed);
+  while (1)
+  {
+    mpmc_slot_t *slot = &ring->slots[pos % ring->capacity];
+    size_t seq = atomic_load_explicit(&slot->seq, memory_order_acquire);
+    intptr_t diff = (intptr_t)seq - (intptr_t)(2 * pos);
+    if (diff == 0)
+    {
+      if (atomic_compare_exchange_weak_explicit(&ring->head, &pos, pos + 1,
+                                                memory_order_relaxed, memory_order_relaxed))
+      {
+        slot->item = item;
+        atomic_store_explicit(&slot->seq, 2 * pos + 1, memory_order_release);
+        return 0;
+      }
+      // lost the race, pos now holds the current head
+    }
+    else if (diff < 0)
+    {
+      return -1; // the slot still holds an item from the previous lap
+    }
+    else
+    {
+      pos = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    }
+  }
+}
+
+/**
+ * removes the oldest item without blocking
+ * a slot at position pos holds an item when its sequence number equals
+ * 2 * pos + 1; after taking the item the consumer frees the slot for the next
+ * lap by setting the sequence number to 2 * (pos + capacity)
+ *
+ * @param ring the ring
+ * @param item the removed item
+ * @return 0 on success, -1 if the ring is empty
+ */
+int mpmc_ring_pop(mpmc_ring_t *ring, void **item)
+{
+  size_t pos = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+  while (1)
+  {
+    mpmc_slot_t *slot = &ring->slots[pos % ring->capacity];
+    size_t seq = atomic_load_explicit(&slot->seq, memory_order_acquire);
+    intptr_t diff = (intptr_t)seq - (intptr_t)(2 * pos + 1);
+    if (diff == 0)
+    {
+      if (atomic_compare_exchange_weak_explicit(&ring->tail, &pos, pos + 1,
+                                                memory_order_relaxed, memory_order_relaxed))
+      {
+        *item = slot->item;
+        atomic_store_explicit(&slot->seq, 2 * (pos + ring->capacity), memory_order_release);
+        return 0;
+      }
+    }
+    else if (diff < 0)
+    {
+      return -1; // nothing published at this position yet
+    }
+    else
+    {
+      pos = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+    }
+  }
+}
+
+/**
+ * looks at the oldest item without removing it
+ * only a snapshot: a consumer may pop the item right after this returns, so
+ * unless the caller is the only consumer the item must be treated as an
+ * opaque value and not dereferenced
+ *
+ * @param ring the ring
+ * @param item the oldest item
+ * @return 0 on success, -1 if the ring is empty or the item was popped and
+ *         its slot refilled while it was being read
+ */
+int mpmc_ring_peek(mpmc_ring_t *ring, void **item)
+{
+  size_t pos = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+  mpmc_slot_t *slot = &ring->slots[pos % ring->capacity];
+  if (atomic_load_explicit(&slot->seq, memory_order_acquire) != 2 * pos + 1)
+    return -1;
+  *item = slot->item;
+  // a producer refilling the slot moves seq on first, so an unchanged seq
+  // means the item read is the one published at pos
+  atomic_thread_fence(memory_order_acquire);
+  return atomic_load_explicit(&slot->seq, memory_order_relaxed) == 2 * pos + 1 ? 0 : -1;
+}
+
+void waitq_init(waitq_t *q)
+{
+  atomic_init(&q->epoch, 0);
+  atomic_init(&q->waiters, 0);
+}
+
+/**
+ * announces that the calling thread is about to park
+ * the caller must check its condition again after this call and then either
+ * waitq_wait() with the returned epoch or waitq_cancel(); a signal sent after
+ * the check changes the epoch, so the wait returns at once instead of missing it
+ *
+ * @param q the wait queue
+ * @return the epoch to pass to waitq_wait()
+ */
+uint32_t waitq_prepare(waitq_t *q)
+{
+  atomic_fetch_add(&q->waiters, 1);
+  return atomic_load(&q->epoch);
+}
+
+/**
+ * parks the calling thread until the epoch moves past the given value
+ * may return spuriously; callers re-check their condition in a loop
+ */
+void waitq_wait(waitq_t *q, uint32_t epoch)
+{
+  syscall(SYS_futex, &q->epoch, FUTEX_WAIT_PRIVATE, epoch, NULL, NULL, 0);
+  atomic_fetch_sub(&q->waiters, 1);
+}
+
+/**
+ * parks like waitq_wait(), but for at most timeout_ms milliseconds
+ *
+ * @return 0 if woken (or spuriously), -1 if the timeout passed
+ */
+int waitq_wait_timeout(waitq_t *q, uint32_t epoch, int timeout_ms)
+{
+  struct timespec timeout = {timeout_ms / 1000, (timeout_ms % 1000) * 1000000L};
+  long rc = syscall(SYS_futex, &q->epoch, FUTEX_WAIT_PRIVATE, epoch, &timeout, NULL, 0);
+  int timed_out = rc < 0 && errno == ETIMEDOUT;
+  atomic_fetch_sub(&q->waiters, 1);
+  return timed_out ? -1 : 0;
+}
+
+void waitq_cancel(waitq_t *q)
+{
+  atomic_fetch_sub(&q->waiters, 1);
+}
+
+/**
+ * signals progress and wakes at most one parked thread
+ * when nobody is parked this is a fence and a load: the shared epoch is only
+ * written when there is a thread to wake. The fence orders the caller's state
+ * change before the load of waiters, pairing with the increment in
+ * waitq_prepare(): either the waiter's re-check sees the change, or this
+ * load sees the waiter
+ */
+void waitq_wake_one(waitq_t *q)
+{
+  atomic_thread_fence(memory_order_seq_cst);
+  if (atomic_load(&q->waiters) == 0)
+    return;
+  atomic_fetch_add(&q->epoch, 1);
+  syscall(SYS_futex, &q->epoch, FUTEX_WAKE_PRIVATE, 1, NULL, NULL, 0);
+}
+
+/**
+ * tells whether a thread is parked (or about to park) on the queue
+ */
+int waitq_has_waiters(waitq_t *q)
+{
+  atomic_thread_fence(memory_order_seq_cst);
+  return atomic_load(&q->waiters) > 0;
+}
@@ -0,0 +1,49 @@
+#ifndef __MPMC_H__
+#define __MPMC_H__
+
+#include <stdatomic.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define CACHE_LINE 64
+
+// a slot of the ring; seq tells producers and consumers whose turn it is
+typedef struct
+{
+  _Atomic size_t seq;
+  void *item;
+} mpmc_slot_t;
+
+// bounded lock-free multi-producer multi-consumer ring (Vyukov's algorithm)
+// head and tail live on separate cache lines so producers and consumers do
+// not invalidate each other's line on every operation
+typedef struct
+{
+  _Alignas(CACHE_LINE) _Atomic size_t head; // next position to push to
+  _Alignas(CACHE_LINE) _Atomic size_t tail; // next position to pop from
+  _Alignas(CACHE_LINE) mpmc_slot_t *slots;
+  size_t capacity;
+} mpmc_ring_t;
+
+// an event count: threads park on it until another thread signals progress,
+// and each signal wakes at most one of them
+typedef struct
+{
+  _Alignas(CACHE_LINE) _Atomic uint32_t epoch; // futex word, bumped on every signal
+  _Atomic uint32_t waiters;                    // threads between prepare and wait/cancel
+} waitq_t;
+
+int mpmc_ring_init(mpmc_ring_t *ring, size_t capacity);
+int mpmc_ring_push(mpmc_ring_t *ring, void *item);
+int mpmc_ring_pop(mpmc_ring_t *ring, void **item);
+int mpmc_ring_peek(mpmc_ring_t *ring, void **item);
+
+void waitq_init(waitq_t *q);
+uint32_t waitq_prepare(waitq_t *q);
+void waitq_wait(waitq_t *q, uint32_t epoch);
+int waitq_wait_timeout(waitq_t *q, uint32_t epoch, int timeout_ms);
+void waitq_cancel(waitq_t *q);
+void waitq_wake_one(waitq_t *q);
+int waitq_has_waiters(waitq_t *q);
+
+#endif // __MPMC_H__
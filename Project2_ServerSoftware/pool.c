@@ -0,0 +1,194 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include "pool.h"
+#include "io_helper.h"
+
+// what a new worker thread is started with
+typedef struct
+{
+  pool_t *pool;
+  int id;
+} pool_start_t;
+
+static void *pool_thread(void *arg)
+{
+  pool_start_t start = *(pool_start_t *)arg;
+  free(arg);
+  start.pool->worker(start.pool, start.id);
+  return NULL;
+}
+
+/**
+ * starts one more worker; must be called with the mutex held
+ *
+ * @return 0 on success, -1 if the thread could not be created
+ */
+static int pool_start(pool_t *p)
+{
+  pthread_t thread;
+  pthread_attr_t attr;
+  pool_start_t *start = (pool_start_t *)malloc(sizeof(pool_start_t));
+  if (!start)
+    return -1;
+  start->pool = p;
+  start->id = p->next_id;
+
+  pthread_attr_init(&attr);
+  pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+  int rc = pthread_create(&thread, &attr, pool_thread, start);
+  pthread_attr_destroy(&attr);
+  if (rc != 0)
+  {
+    free(start);
+    return -1;
+  }
+  p->next_id++;
+  p->threads++;
+  if (p->threads > p->peak)
+    p->peak = p->threads;
+  return 0;
+}
+
+/**
+ * adds workers once requests have waited POOL_GROW_WAIT_MS with every worker
+ * busy: one for each waiting request, up to the maximum, since a burst of
+ * requests blocked on CGI programs needs them all at once
+ */
+static void pool_check(pool_t *p, long long now)
+{
+  int depth = p->depth(p);
+
+  pthread_mutex_lock(&p->mutex);
+  if (depth == 0 || atomic_load(&p->busy) < p->threads)
+  {
+    p->backlog_since = 0;
+  }
+  else if (p->backlog_since == 0)
+  {
+    p->backlog_since = now;
+  }
+  else if (now - p->backlog_since >= POOL_GROW_WAIT_MS * 1000LL && p->threads < p->max)
+  {
+    int from = p->threads;
+    int add = depth < p->max - p->threads ? depth : p->max - p->threads;
+    while (add-- > 0 && pool_start(p) == 0)
+      p->grown++;
+    fprintf(stderr, "pool %s: %d requests waited %lld ms with every worker busy, grew from %d to %d workers\n",
+            p->name, depth, (now - p->backlog_since) / 1000, from, p->threads);
+    p->backlog_since = 0;
+  }
+  pthread_mutex_unlock(&p->mutex);
+}
+
+static void *pool_manager(void *arg)
+{
+  pool_t *p = (pool_t *)arg;
+  while (1)
+  {
+    usleep(POOL_TICK_MS * 1000);
+    pool_check(p, now_usec());
+  }
+  return NULL;
+}
+
+/**
+ * starts the minimum number of workers, and the manager thread if the pool
+ * may grow
+ *
+ * @param p the pool to initialize
+ * @param name names the pool in log lines
+ * @param min workers that always run
+ * @param max workers the pool may grow to
+ * @param worker runs each worker thread
+ * @param depth reports how many requests wait for a worker
+ * @param arg the caller's state, kept in p->arg
+ * @return 0 on success, -1 if a thread could not be created
+ */
+int pool_init(pool_t *p, const char *name, int min, int max, pool_worker_fn worker, pool_depth_fn depth, void *arg)
+{
+  pthread_mutex_init(&p->mutex, NULL);
+  p->name = name;
+  p->worker = worker;
+  p->depth = depth;
+  p->arg = arg;
+  p->min = min;
+  p->max = max;
+  p->threads = 0;
+  atomic_init(&p->busy, 0);
+  p->next_id = 0;
+  p->backlog_since = 0;
+  p->grown = p->shrunk = 0;
+  p->peak = 0;
+
+  pthread_mutex_lock(&p->mutex);
+  int rc = 0;
+  for (int i = 0; i < min && rc == 0; i++)
+    rc = pool_start(p);
+  pthread_mutex_unlock(&p->mutex);
+  if (rc < 0)
+    return -1;
+
+  if (max > min)
+  {
+    pthread_t manager;
+    if (pthread_create(&manager, NULL, pool_manager, p) != 0)
+      return -1;
+    pthread_detach(manager);
+  }
+  return 0;
+}
+
+/**
+ * how long a worker waits for a request before it offers to retire
+ *
+ * @return milliseconds, or 0 if the pool has a fixed size and workers wait forever
+ */
+int pool_idle_ms(pool_t *p)
+{
+  return p->max > p->min ? POOL_IDLE_MS : 0;
+}
+
+void pool_begin(pool_t *p)
+{
+  atomic_fetch_add(&p->busy, 1);
+}
+
+void pool_end(pool_t *p)
+{
+  atomic_fetch_sub(&p->busy, 1);
+}
+
+/**
+ * called by a worker that found no request for pool_idle_ms()
+ *
+ * @return 1 if the worker must exit, 0 if the pool is at its minimum and it keeps waiting
+ */
+int pool_retire(pool_t *p)
+{
+  int retire = 0;
+
+  pthread_mutex_lock(&p->mutex);
+  if (p->threads > p->min)
+  {
+    p->threads--;
+    p->shrunk++;
+    retire = 1;
+    fprintf(stderr, "pool %s: worker idle for %d ms, shrank to %d workers\n", p->name, POOL_IDLE_MS, p->threads);
+  }
+  pthread_mutex_unlock(&p->mutex);
+  return retire;
+}
+
+void pool_stats(pool_t *p, pool_stats_t *stats)
+{
+  pthread_mutex_lock(&p->mutex);
+  stats->min = p->min;
+  stats->max = p->max;
+  stats->threads = p->threads;
+  stats->busy = atomic_load(&p->busy);
+  stats->peak = p->peak;
+  stats->grown = p->grown;
+  stats->shrunk = p->shrunk;
+  pthread_mutex_unlock(&p->mutex);
+}
@@ -0,0 +1,56 @@
+#ifndef __POOL_H__
+#define __POOL_H__
+
+#include <pthread.h>
+#include <stdatomic.h>
+
+// elastic pool settings
+#define POOL_TICK_MS 10         // how often the pool checks the queue
+#define POOL_GROW_WAIT_MS 20    // requests waiting this long with every worker busy add workers
+#define POOL_IDLE_MS 10000      // a worker above the minimum exits after parking this long
+
+struct pool;
+
+// runs a worker until it retires; id counts up from 0 in the order workers start
+typedef void (*pool_worker_fn)(struct pool *p, int id);
+
+// reports how many requests wait for one of the pool's workers
+typedef int (*pool_depth_fn)(struct pool *p);
+
+// the worker threads; with a minimum below the maximum a manager thread adds
+// workers while requests back up and idle workers retire on their own
+typedef struct pool
+{
+  pthread_mutex_t mutex;
+  const char *name; // used in log lines
+  pool_worker_fn worker;
+  pool_depth_fn depth;
+  void *arg;        // the caller's state for the worker and depth functions
+  int min, max;
+  int threads;              // running workers
+  _Atomic int busy;         // workers serving a request
+  int next_id;              // index passed to the next worker started
+  long long backlog_since;  // when requests started waiting with every worker busy, 0 if not
+  long long grown, shrunk;  // workers added and retired since startup
+  int peak;
+} pool_t;
+
+// counters reported by the pool; only a snapshot while workers come and go
+typedef struct
+{
+  int min, max;
+  int threads;
+  int busy;
+  int peak;
+  long long grown;
+  long long shrunk;
+} pool_stats_t;
+
+int pool_init(pool_t *p, const char *name, int min, int max, pool_worker_fn worker, pool_depth_fn depth, void *arg);
+int pool_idle_ms(pool_t *p);
+void pool_begin(pool_t *p);
+void pool_end(pool_t *p);
+int pool_retire(pool_t *p);
+void pool_stats(pool_t *p, pool_stats_t *stats);
+
+#endif // __POOL_H__
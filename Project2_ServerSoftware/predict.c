@@ -0,0 +1,110 @@
+#include <pthread.h>
+#include <stdatomic.h>
+#include "predict.h"
+
+// the service time history of one request class
+typedef struct
+{
+  unsigned long long job_class; // 0 while the slot is unused
+  long long ewma_us;            // exponentially weighted moving average of service times
+  long long samples;
+} predict_slot_t;
+
+// one independently locked part of the table; classes are mapped straight to
+// a slot by their hash, so the table stays bounded however many classes appear
+typedef struct
+{
+  pthread_mutex_t mutex;
+  predict_slot_t slots[PREDICT_SLOTS];
+} predict_shard_t;
+
+static predict_shard_t shards[PREDICT_SHARDS];
+
+// average over all classes, the prediction for a class never seen before;
+// updated without a lock, so a concurrent sample may occasionally be lost
+static _Atomic long long overall_us = PREDICT_DEFAULT_US;
+
+void predict_init(void)
+{
+  for (int i = 0; i < PREDICT_SHARDS; i++)
+    pthread_mutex_init(&shards[i].mutex, NULL);
+}
+
+/**
+ * extends a 64-bit FNV-1a hash with more bytes; start with hash 0
+ * 64 bits make collisions between request classes unlikely enough that the
+ * hash alone identifies a class
+ *
+ * @param hash hash of the bytes so far, or 0 to start
+ * @param data the bytes to add
+ * @param len number of bytes
+ * @return the extended hash, never 0
+ */
+unsigned long long predict_hash(unsigned long long hash, const char *data, size_t len)
+{
+  if (hash == 0)
+    hash = 14695981039346656037ull;
+  for (size_t i = 0; i < len; i++)
+  {
+    hash ^= (unsigned char)data[i];
+    hash *= 1099511628211ull;
+  }
+  return hash ? hash : 1;
+}
+
+static predict_slot_t *predict_slot(unsigned long long job_class, predict_shard_t **shard)
+{
+  *shard = &shards[job_class % PREDICT_SHARDS];
+  return &(*shard)->slots[job_class / PREDICT_SHARDS % PREDICT_SLOTS];
+}
+
+/**
+ * predicts how long a request of the given class will take to serve
+ *
+ * @param job_class hash identifying the class
+ * @return the class's average service time in microseconds, or the average
+ *         over all classes if the class has no history
+ */
+long long predict_service_time(unsigned long long job_class)
+{
+  predict_shard_t *shard;
+  predict_slot_t *slot = predict_slot(job_class, &shard);
+  long long usec = -1;
+
+  pthread_mutex_lock(&shard->mutex);
+  if (slot->job_class == job_class)
+    usec = slot->ewma_us;
+  pthread_mutex_unlock(&shard->mutex);
+
+  return usec >= 0 ? usec : atomic_load_explicit(&overall_us, memory_order_relaxed);
+}
+
+/**
+ * adds a measured service time to its class's average, taking over the slot
+ * if another class held it
+ *
+ * @param job_class hash identifying the class
+ * @param usec time the request took to serve, in microseconds
+ */
+void predict_record(unsigned long long job_class, long long usec)
+{
+  predict_shard_t *shard;
+  predict_slot_t *slot = predict_slot(job_class, &shard);
+
+  pthread_mutex_lock(&shard->mutex);
+  if (slot->job_class != job_class)
+  {
+    slot->job_class = job_class;
+    slot->ewma_us = usec;
+    slot->samples = 0;
+  }
+  else
+  {
+    slot->ewma_us += (usec - slot->ewma_us) >> PREDICT_EWMA_SHIFT;
+  }
+  slot->samples++;
+  pthread_mutex_unlock(&shard->mutex);
+
+  long long overall = atomic_load_explicit(&overall_us, memory_order_relaxed);
+  atomic_store_explicit(&overall_us, overall + ((usec - overall) >> PREDICT_EWMA_SHIFT), memory_order_relaxed);
+}
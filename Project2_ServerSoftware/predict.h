@@ -0,0 +1,17 @@
+#ifndef __PREDICT_H__
+#define __PREDICT_H__
+
+#include <stddef.h>
+
+// predictor settings
+#define PREDICT_SHARDS 16       // independently locked parts of the table
+#define PREDICT_SLOTS 64        // classes per shard; a new class replaces the one in its slot
+#define PREDICT_EWMA_SHIFT 3    // each new sample moves the average by 1/8 of the difference
+#define PREDICT_DEFAULT_US 1000 // prediction before any request has completed
+
+void predict_init(void);
+unsigned long long predict_hash(unsigned long long hash, const char *data, size_t len);
+long long predict_service_time(unsigned long long job_class);
+void predict_record(unsigned long long job_class, long long usec);
+
+#endif // __PREDICT_H__
@@ -0,0 +1,556 @@
+#define _GNU_SOURCE
+#include "reactor.h"
+#include "request.h"
+#include "stats.h"
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+
+#define MAX_EVENTS 256
+#define ACCEPT_BATCH 64
+#define SWEEP_INTERVAL_MS 1000
+
+int keepalive_timeout = DEFAULT_KEEPALIVE_TIMEOUT;
+int keepalive_max_requests = DEFAULT_KEEPALIVE_MAX_REQUESTS;
+int header_timeout = DEFAULT_HEADER_TIMEOUT;
+int io_backend = IO_BACKEND_SYSCALL;
+
+/**
+ * closes a client connection and releases its buffer
+ *
+ * @param conn the connection to close
+ */
+void conn_close(conn_t *conn)
+{
+  close_or_die(conn->fd);
+  free(conn);
+}
+
+/**
+ * tells whether the connection may stay open after the current response
+ * keep-alive must be enabled (-k > 0) and the per-connection request limit not reached
+ *
+ * @param conn the connection being served
+ * @return 1 if the connection may be reused, 0 otherwise
+ */
+int conn_may_keep_alive(conn_t *conn)
+{
+  return keepalive_timeout > 0 && conn->requests + 1 < keepalive_max_requests;
+}
+
+/**
+ * checks whether the buffered bytes hold a complete request and parses it
+ * the cheap scan for the blank line runs on every read; the full parse only
+ * runs once, when the headers are complete
+ *
+ * @param conn the connection to check
+ * @param old_len number of bytes that were already checked on a previous call
+ * @return 1 if conn->req holds a complete request, 0 if more data is needed,
+ *         -1 if the request is malformed or does not fit in the buffer
+ */
+static int conn_parse(conn_t *conn, int old_len)
+{
+  conn->header_len = 0;
+  if (find_header_end(conn->buf, conn->len, old_len) > 0)
+  {
+    int rc = http_parse_request(conn->buf, conn->len, &conn->req);
+    if (rc < 0)
+      return -1;
+    conn->header_len = rc;
+    if (rc > 0)
+      return 1;
+  }
+  return conn->len < CONN_BUFSIZE - 1 ? 0 : -1;
+}
+
+/**
+ * appends a connection to the tail of the idle list (most recently active)
+ */
+static void idle_push(reactor_t *reactor, conn_t *conn)
+{
+  conn->last_active = now_usec();
+  conn->next = NULL;
+  conn->prev = reactor->idle_tail;
+  if (reactor->idle_tail)
+    reactor->idle_tail->next = conn;
+  else
+    reactor->idle_head = conn;
+  reactor->idle_tail = conn;
+}
+
+/**
+ * unlinks a connection from the idle list
+ */
+static void idle_remove(reactor_t *reactor, conn_t *conn)
+{
+  if (conn->prev)
+    conn->prev->next = conn->next;
+  else
+    reactor->idle_head = conn->next;
+  if (conn->next)
+    conn->next->prev = conn->prev;
+  else
+    reactor->idle_tail = conn->prev;
+  conn->prev = conn->next = NULL;
+}
+
+/**
+ * appends a connection whose request has just started to the reading list;
+ * every entry gets the same timeout, so the list stays ordered by deadline
+ */
+static void reading_push(reactor_t *reactor, conn_t *conn)
+{
+  if (conn->reading)
+    return;
+  conn->reading = 1;
+  conn->header_start = now_usec();
+  conn->rnext = NULL;
+  conn->rprev = reactor->reading_tail;
+  if (reactor->reading_tail)
+    reactor->reading_tail->rnext = conn;
+  else
+    reactor->reading_head = conn;
+  reactor->reading_tail = conn;
+}
+
+/**
+ * starts the trace of a request whose headers have just become complete; a
+ * request that was not on the reading list arrived whole, just now
+ */
+static void conn_trace_start(conn_t *conn, long long now)
+{
+  long long accepted = conn->trace.accepted_us;
+  memset(&conn->trace, 0, sizeof(conn->trace));
+  conn->trace.accepted_us = accepted;
+  conn->trace.start_us = conn->reading ? conn->header_start : now;
+  conn->trace.parsed_us = now;
+}
+
+/**
+ * unlinks a connection from the reading list, if it is on it
+ */
+static void reading_remove(reactor_t *reactor, conn_t *conn)
+{
+  if (!conn->reading)
+    return;
+  conn->reading = 0;
+  if (conn->rprev)
+    conn->rprev->rnext = conn->rnext;
+  else
+    reactor->reading_head = conn->rnext;
+  if (conn->rnext)
+    conn->rnext->rprev = conn->rprev;
+  else
+    reactor->reading_tail = conn->rprev;
+  conn->rprev = conn->rnext = NULL;
+}
+
+/**
+ * removes a connection from the reactor and closes it
+ */
+static void reactor_drop(reactor_t *reactor, conn_t *conn)
+{
+  idle_remove(reactor, conn);
+  reading_remove(reactor, conn);
+  epoll_ctl(reactor->epoll_fd, EPOLL_CTL_DEL, conn->fd, NULL);
+  conn_close(conn);
+}
+
+/**
+ * initializes a reactor around an already listening socket
+ * the listening socket is switched to non-blocking mode so that accepts can be
+ * drained in batches without ever blocking the event loop
+ *
+ * @param reactor the reactor to initialize
+ * @param listen_fd listening socket returned by open_listen_fd()
+ * @param dispatch callback receiving connections whose headers are complete
+ */
+void reactor_init(reactor_t *reactor, int listen_fd, reactor_dispatch_fn dispatch)
+{
+  reactor->listen_fd = listen_fd;
+  reactor->dispatch = dispatch;
+  reactor->resume_list = NULL;
+  reactor->idle_head = reactor->idle_tail = NULL;
+  reactor->reading_head = reactor->reading_tail = NULL;
+  reactor->arg = NULL;
+  reactor->use_ring = 0;
+  if (io_backend == IO_BACKEND_URING)
+  {
+    if (uring_init(&reactor->ring, MAX_EVENTS) == 0)
+      reactor->use_ring = 1;
+    else
+      fprintf(stderr, "io_uring is unavailable (%s), reading with recv()\n", strerror(errno));
+  }
+  pthread_mutex_init(&reactor->resume_mutex, NULL);
+
+  int flags = fcntl(listen_fd, F_GETFL, 0);
+  assert(flags >= 0);
+  assert(fcntl(listen_fd, F_SETFL, flags | O_NONBLOCK) == 0);
+
+  reactor->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+  assert(reactor->epoll_fd >= 0);
+  reactor->wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+  assert(reactor->wake_fd >= 0);
+
+  struct epoll_event ev;
+  ev.events = EPOLLIN;
+  ev.data.ptr = NULL; // NULL marks the listening socket
+  assert(epoll_ctl(reactor->epoll_fd, EPOLL_CTL_ADD, listen_fd, &ev) == 0);
+
+  ev.events = EPOLLIN;
+  ev.data.ptr = &reactor->wake_fd; // marks the wake-up eventfd
+  assert(epoll_ctl(reactor->epoll_fd, EPOLL_CTL_ADD, reactor->wake_fd, &ev) == 0);
+}
+
+/**
+ * hands a connection that is no longer watched to the dispatch callback, or
+ * answers 400 and closes it if its request could not be parsed
+ *
+ * @param reactor the reactor the connection came from
+ * @param conn the connection, with conn->header_len set by conn_parse()
+ */
+static void reactor_ready(reactor_t *reactor, conn_t *conn)
+{
+  if (conn->header_len == 0)
+  {
+    conn->keep_alive = 0;
+    request_error(conn, "request", "400", "Bad Request", "request could not be parsed");
+    conn_close(conn);
+    return;
+  }
+
+  reactor->dispatch(conn);
+}
+
+/**
+ * starts watching a connection for its next request
+ * if the buffer already holds a complete pipelined request it is dispatched
+ * right away, since no further readiness event would arrive for it
+ *
+ * @param reactor the reactor taking ownership of the connection
+ * @param conn the connection to watch
+ */
+static void reactor_watch(reactor_t *reactor, conn_t *conn)
+{
+  if (conn->len > 0 && conn_parse(conn, 0) != 0)
+  {
+    conn_trace_start(conn, now_usec());
+    reactor_ready(reactor, conn);
+    return;
+  }
+
+  struct epoll_event ev;
+  ev.events = EPOLLIN | EPOLLRDHUP;
+  ev.data.ptr = conn;
+  if (epoll_ctl(reactor->epoll_fd, EPOLL_CTL_ADD, conn->fd, &ev) < 0)
+  {
+    conn_close(conn);
+    return;
+  }
+  idle_push(reactor, conn);
+
+  // a new connection owes a request at once, and pipelined bytes have
+  // already started the next one
+  if (conn->requests == 0 || conn->len > 0)
+    reading_push(reactor, conn);
+}
+
+/**
+ * accepts up to ACCEPT_BATCH pending connections and registers them for reading
+ * client sockets stay in blocking mode, because the worker threads and CGI programs
+ * write to them with plain blocking writes; the reactor reads them with MSG_DONTWAIT
+ *
+ * @param reactor the reactor owning the listening socket
+ */
+static void reactor_accept(reactor_t *reactor)
+{
+  for (int i = 0; i < ACCEPT_BATCH; i++)
+  {
+    struct sockaddr_in client_addr;
+    socklen_t client_len = sizeof(client_addr);
+    int conn_fd = accept4(reactor->listen_fd, (sockaddr_t *)&client_addr, &client_len, SOCK_CLOEXEC);
+    if (conn_fd < 0)
+    {
+      if (errno == EINTR || errno == ECONNABORTED)
+        continue;
+      if (errno != EAGAIN && errno != EWOULDBLOCK)
+        fprintf(stderr, "accept() failed: %s\n", strerror(errno));
+      return;
+    }
+    stats_count(STATS_ACCEPTED, 1);
+
+    conn_t *conn = (conn_t *)malloc(sizeof(conn_t));
+    if (!conn)
+    {
+      close(conn_fd);
+      continue;
+    }
+    conn->fd = conn_fd;
+    conn->addr = client_addr;
+    conn->reactor = reactor;
+    conn->len = 0;
+    conn->header_len = 0;
+    conn->requests = 0;
+    conn->keep_alive = 0;
+    conn->http11 = 0;
+    conn->buf[0] = '\0';
+    conn->prev = conn->next = NULL;
+    conn->reading = 0;
+    conn->rprev = conn->rnext = NULL;
+    conn->trace.accepted_us = now_usec();
+
+    reactor_watch(reactor, conn);
+  }
+}
+
+/**
+ * takes in the bytes a read from a client socket returned and, once the
+ * request line and headers are complete, dispatches the request
+ *
+ * @param n what recv() returned; errno is set when it is negative
+ */
+static void reactor_received(reactor_t *reactor, conn_t *conn, ssize_t n)
+{
+  int old_len = conn->len;
+  if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR))
+    return;
+
+  if (n <= 0)
+  {
+    // client went away before finishing its request
+    reactor_drop(reactor, conn);
+    return;
+  }
+
+  conn->len += n;
+  conn->buf[conn->len] = '\0';
+
+  if (conn_parse(conn, old_len) == 0)
+  {
+    // wait for more data; the client counts as active again, but the header
+    // timeout keeps running from the first byte of the request
+    idle_remove(reactor, conn);
+    idle_push(reactor, conn);
+    reading_push(reactor, conn);
+    return;
+  }
+
+  conn_trace_start(conn, now_usec());
+  idle_remove(reactor, conn);
+  reading_remove(reactor, conn);
+  epoll_ctl(reactor->epoll_fd, EPOLL_CTL_DEL, conn->fd, NULL);
+  reactor_ready(reactor, conn);
+}
+
+/**
+ * reads whatever the client has sent so far into the connection buffer
+ * once the request line and all headers are present and parsed, the connection
+ * is removed from the epoll set and handed to the dispatch callback
+ *
+ * @param reactor the reactor the connection is registered with
+ * @param conn the readable connection
+ */
+static void reactor_read(reactor_t *reactor, conn_t *conn)
+{
+  ssize_t n = recv(conn->fd, conn->buf + conn->len, CONN_BUFSIZE - 1 - conn->len, MSG_DONTWAIT);
+  reactor_received(reactor, conn, n);
+}
+
+/**
+ * reads every socket of an epoll batch with a single io_uring submission
+ * instead of one recv() each; falls back to recv() if the ring fails, and for
+ * any connection the ring could not take or returned no completion for
+ *
+ * each entry carries the batch number in its upper 32 bits and the position
+ * in conns in the lower ones, and the completion queue is always drained, so
+ * a completion can never be credited to a connection of a later batch
+ *
+ * @param conns the connections epoll reported readable
+ * @param count number of connections, at most MAX_EVENTS
+ */
+static void reactor_read_batch(reactor_t *reactor, conn_t **conns, int count)
+{
+  unsigned batch = ++reactor->ring_batch;
+  int answered[MAX_EVENTS];
+  int queued = 0;
+  for (int i = 0; i < count; i++)
+  {
+    conn_t *conn = conns[i];
+    answered[i] = 0;
+    if (uring_prep_recv(&reactor->ring, conn->fd, conn->buf + conn->len, CONN_BUFSIZE - 1 - conn->len,
+                        MSG_DONTWAIT, (unsigned long long)batch << 32 | i) == 0)
+    {
+      queued++;
+    }
+    else
+    {
+      answered[i] = 1;
+      reactor_read(reactor, conn);
+    }
+  }
+  if (queued == 0)
+    return;
+
+  int failed = uring_submit_and_wait(&reactor->ring, queued) < 0;
+  if (failed)
+    fprintf(stderr, "io_uring_enter() failed: %s, reading with recv()\n", strerror(errno));
+
+  // entries the kernel consumed before a failure have completed into the
+  // connection buffers too, so they are credited before the ring goes away
+  unsigned long long user_data;
+  int res;
+  while (uring_reap(&reactor->ring, &user_data, &res) == 0)
+  {
+    unsigned index = (unsigned)user_data;
+    if ((unsigned)(user_data >> 32) != batch || index >= (unsigned)count || answered[index])
+      continue;
+    answered[index] = 1;
+    errno = res < 0 ? -res : 0;
+    reactor_received(reactor, conns[index], res < 0 ? -1 : res);
+  }
+
+  if (failed)
+  {
+    uring_exit(&reactor->ring);
+    reactor->use_ring = 0;
+  }
+
+  // a connection whose read never completed is read directly rather than
+  // left for the next epoll round
+  for (int i = 0; i < count; i++)
+  {
+    if (!answered[i])
+      reactor_read(reactor, conns[i]);
+  }
+}
+
+/**
+ * takes back the connections that workers finished with and watches them again
+ *
+ * @param reactor the reactor to drain the resume list of
+ */
+static void reactor_resume_all(reactor_t *reactor)
+{
+  uint64_t count;
+  while (read(reactor->wake_fd, &count, sizeof(count)) > 0)
+    ;
+
+  pthread_mutex_lock(&reactor->resume_mutex);
+  conn_t *conn = reactor->resume_list;
+  reactor->resume_list = NULL;
+  pthread_mutex_unlock(&reactor->resume_mutex);
+
+  while (conn)
+  {
+    conn_t *next = conn->next;
+    conn->prev = conn->next = NULL;
+    reactor_watch(reactor, conn);
+    conn = next;
+  }
+}
+
+/**
+ * closes the connections that have been idle for longer than the keep-alive timeout
+ * the idle list is ordered by last activity, so only expired entries are visited
+ *
+ * @param reactor the reactor owning the idle connections
+ */
+static void reactor_sweep(reactor_t *reactor)
+{
+  long long now = now_usec();
+
+  if (keepalive_timeout > 0)
+  {
+    long long deadline = now - (long long)keepalive_timeout * 1000000;
+    while (reactor->idle_head && reactor->idle_head->last_active < deadline)
+    {
+      reactor_drop(reactor, reactor->idle_head);
+    }
+  }
+
+  // a client trickling its headers a byte at a time never goes idle, so it
+  // is closed once its request has taken longer than the header timeout;
+  // nothing is written, since a client that does not read could block it
+  if (header_timeout > 0)
+  {
+    long long deadline = now - (long long)header_timeout * 1000000;
+    while (reactor->reading_head && reactor->reading_head->header_start < deadline)
+    {
+      reactor_drop(reactor, reactor->reading_head);
+    }
+  }
+}
+
+/**
+ * finishes a request on behalf of a worker thread
+ * persistent connections have the served request dropped from their buffer
+ * (keeping any pipelined bytes) and are handed back to their reactor; all
+ * other connections are closed
+ *
+ * @param conn the connection whose response has been written
+ */
+void conn_done(conn_t *conn)
+{
+  conn->requests++;
+  if (!conn->keep_alive)
+  {
+    conn_close(conn);
+    return;
+  }
+
+  conn->len -= conn->header_len;
+  memmove(conn->buf, conn->buf + conn->header_len, conn->len);
+  conn->buf[conn->len] = '\0';
+  conn->header_len = 0;
+
+  reactor_t *reactor = conn->reactor;
+  pthread_mutex_lock(&reactor->resume_mutex);
+  conn->next = reactor->resume_list;
+  reactor->resume_list = conn;
+  pthread_mutex_unlock(&reactor->resume_mutex);
+
+  uint64_t one = 1;
+  ssize_t rc = write(reactor->wake_fd, &one, sizeof(one));
+  (void)rc;
+}
+
+/**
+ * runs the event loop forever
+ * the listening socket is drained in batches, and every client connection is
+ * buffered here until its request is complete, so a slow or idle client never
+ * occupies a worker thread
+ *
+ * @param reactor the reactor to run
+ */
+void reactor_run(reactor_t *reactor)
+{
+  struct epoll_event events[MAX_EVENTS];
+  conn_t *readable[MAX_EVENTS];
+
+  while (1)
+  {
+    int timeout = reactor->idle_head || reactor->reading_head ? SWEEP_INTERVAL_MS : -1;
+    int n = epoll_wait(reactor->epoll_fd, events, MAX_EVENTS, timeout);
+    if (n < 0)
+    {
+      assert(errno == EINTR);
+      continue;
+    }
+
+    int num_readable = 0;
+    for (int i = 0; i < n; i++)
+    {
+      if (events[i].data.ptr == NULL)
+        reactor_accept(reactor);
+      else if (events[i].data.ptr == &reactor->wake_fd)
+        reactor_resume_all(reactor);
+      else if (reactor->use_ring)
+        readable[num_readable++] = (conn_t *)events[i].data.ptr;
+      else
+        reactor_read(reactor, (conn_t *)events[i].data.ptr);
+    }
+    if (num_readable > 0)
+      reactor_read_batch(reactor, readable, num_readable);
+
+    reactor_sweep(reactor);
+  }
+}
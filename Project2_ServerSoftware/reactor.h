@@ -0,0 +1,90 @@
+#ifndef __REACTOR_H__
+#define __REACTOR_H__
+
+#include "io_helper.h"
+#include "http.h"
+#include "uring.h"
+
+#define CONN_BUFSIZE (8192)
+
+// default keep-alive settings
+#define DEFAULT_KEEPALIVE_TIMEOUT 5
+#define DEFAULT_KEEPALIVE_MAX_REQUESTS 100
+#define DEFAULT_HEADER_TIMEOUT 10 // seconds a client has to send a complete request line and headers
+
+// how the reactor reads the sockets epoll reports ready (-I)
+#define IO_BACKEND_SYSCALL 0 // one recv() per socket
+#define IO_BACKEND_URING 1   // one io_uring submission for every socket of an epoll batch
+
+struct reactor;
+
+// monotonic times of the phases of a connection's current request, 0 until
+// reached; the enqueue time is the connection's queued_us
+typedef struct
+{
+  long long accepted_us;   // the connection was accepted
+  long long start_us;      // the first byte of the request arrived
+  long long parsed_us;     // the request line and headers were complete
+  long long dequeued_us;   // a worker took the request from the queue
+  long long handler_us;    // the worker started serving it
+  long long first_byte_us; // the first byte of the response was written
+  long long done_us;       // the response was complete
+} request_trace_t;
+
+// a client connection; the reactor owns it until its request line and
+// headers have fully arrived, then it is handed to the dispatch callback
+// and, for persistent connections, handed back after the response
+typedef struct conn
+{
+  int fd;                   // client socket
+  struct sockaddr_in addr;  // client address
+  struct reactor *reactor;  // reactor that owns the idle connection
+  char buf[CONN_BUFSIZE];   // bytes received so far (NUL terminated)
+  int len;                  // number of valid bytes in buf
+  int header_len;           // length of request line + headers, 0 until complete
+  http_request_t req;       // the parsed request, slices point into buf
+  int requests;             // requests completed on this connection
+  int keep_alive;           // whether the current response leaves the connection open
+  int http11;               // client speaks HTTP/1.1 (chunked responses allowed)
+  long long last_active;    // monotonic time of the last activity, for idle timeouts
+  long long queued_us;      // monotonic time the current request was queued for a worker
+  struct conn *prev, *next; // links in the idle list or the resume list
+  int reading;              // in the reading list: a request has started but its headers are incomplete
+  long long header_start;   // monotonic time the current request started, for the header timeout
+  struct conn *rprev, *rnext; // links in the reading list
+  int status;               // status code of the current response, for the access log
+  long long bytes_sent;     // bytes of the current response written so far, for the access log
+  request_trace_t trace;    // for the trace file, the flight recorder and Server-Timing
+} conn_t;
+
+typedef void (*reactor_dispatch_fn)(conn_t *conn);
+
+typedef struct reactor
+{
+  int listen_fd;
+  int epoll_fd;
+  int wake_fd;                   // eventfd signalled when workers hand connections back
+  reactor_dispatch_fn dispatch;
+  pthread_mutex_t resume_mutex;  // protects resume_list
+  conn_t *resume_list;           // connections handed back by workers for reuse
+  conn_t *idle_head, *idle_tail; // connections waiting for a request, oldest first
+  conn_t *reading_head, *reading_tail; // connections still sending their headers, oldest request first
+  void *arg;                     // the caller's state, for the dispatch function
+  int use_ring;                  // reads go through ring (-I uring and io_uring is available)
+  uring_t ring;
+  unsigned ring_batch;           // numbers each ring submission, so a completion names its batch
+} reactor_t;
+
+// keep-alive settings (-k and -r) and the header timeout (-H)
+extern int keepalive_timeout;
+extern int keepalive_max_requests;
+extern int header_timeout;
+extern int io_backend;
+
+void reactor_init(reactor_t *reactor, int listen_fd, reactor_dispatch_fn dispatch);
+void reactor_run(reactor_t *reactor);
+int conn_may_keep_alive(conn_t *conn);
+void conn_done(conn_t *conn);
+void conn_close(conn_t *conn);
+
+#endif // __REACTOR_H__
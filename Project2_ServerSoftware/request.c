@@ -1,5 +1,13 @@
+#define _GNU_SOURCE
 #include "io_helper.h"
 #include "request.h"
+#include "sqldb.h"
+#include "cgi_pool.h"
+#include "file_cache.h"
+#include "stats.h"
+#include "trace.h"
+#include "access_log.h"
+#include <limits.h>
 #include <pthread.h>
 
 //
@@ -9,53 +17,127 @@
 
 #define MAXBUF (8192)
 
-// Mutex for synchronizing printf and other shared operations
-pthread_mutex_t request_mutex = PTHREAD_MUTEX_INITIALIZER;
+// queries sent here run in-process instead of through cgi-bin/sql.cgi
+#define SQL_ROUTE "/sql"
 
-void request_error(int fd, char *cause, char *errnum, char *shortmsg, char *longmsg)
+// the server's counters, as JSON or, with ?format=prometheus, as Prometheus text;
+// ?log_sample=N also changes the access log's sampling rate (-L)
+#define STATS_ROUTE "/__stats"
+#define STATS_LOG_SAMPLE "log_sample="
+
+//
+// Writes a buffer to the client; a failed write (client went away) just
+// marks the connection so that it is not reused
+//
+void request_write(conn_t *conn, const void *buf, size_t len)
+{
+  if (!conn->trace.first_byte_us)
+    conn->trace.first_byte_us = now_usec();
+  if (writen(conn->fd, buf, len) < 0)
+    conn->keep_alive = 0;
+  else
+    conn->bytes_sent += len;
+}
+
+//
+// Writes several buffers to the client with one writev() where possible,
+// e.g. response headers together with a body already in memory
+//
+void request_writev(conn_t *conn, struct iovec *iov, int iovcnt)
+{
+  if (!conn->trace.first_byte_us)
+    conn->trace.first_byte_us = now_usec();
+  if (writevn(conn->fd, iov, iovcnt) < 0)
+  {
+    conn->keep_alive = 0;
+    return;
+  }
+  for (int i = 0; i < iovcnt; i++)
+    conn->bytes_sent += iov[i].iov_len;
+}
+
+//
+// Fills in the Connection header(s) matching conn->keep_alive, followed by
+// Server-Timing with the time the request has taken so far
+//
+void request_connection_header(conn_t *conn, char *buf)
+{
+  int len;
+  if (conn->keep_alive)
+    len = sprintf(buf, "Connection: keep-alive\r\nKeep-Alive: timeout=%d, max=%d\r\n",
+                  keepalive_timeout, keepalive_max_requests - conn->requests - 1);
+  else
+    len = sprintf(buf, "Connection: close\r\n");
+  trace_server_timing(conn, buf + len);
+}
+
+//
+// Sends an error page; extra holds any further header lines, each ending in \r\n
+//
+void request_error_headers(conn_t *conn, char *cause, char *errnum, char *shortmsg, char *longmsg,
+                           const char *extra)
 {
-  char buf[MAXBUF], body[MAXBUF];
+  char buf[2 * MAXBUF], body[MAXBUF], connection[256];
 
   // Create the body of error message first (have to know its length for header)
-  sprintf(body, ""
-                "<!doctype html>\r\n"
-                "<head>\r\n"
-                "  <title>OSTEP WebServer Error</title>\r\n"
-                "</head>\r\n"
-                "<body>\r\n"
-                "  <h2>%s: %s</h2>\r\n"
-                "  <p>%s: %s</p>\r\n"
-                "</body>\r\n"
-                "</html>\r\n",
-          errnum, shortmsg, longmsg, cause);
-
-  // Write out the header information for this response
-  sprintf(buf, "HTTP/1.0 %s %s\r\n", errnum, shortmsg);
-  write_or_die(fd, buf, strlen(buf));
-
-  sprintf(buf, "Content-Type: text/html\r\n");
-  write_or_die(fd, buf, strlen(buf));
-
-  sprintf(buf, "Content-Length: %lu\r\n\r\n", strlen(body));
-  write_or_die(fd, buf, strlen(buf));
-
-  // Write out the body last
-  write_or_die(fd, body, strlen(body));
+  int body_len = snprintf(body, MAXBUF, ""
+                                        "<!doctype html>\r\n"
+                                        "<head>\r\n"
+                                        "  <title>OSTEP WebServer Error</title>\r\n"
+                                        "</head>\r\n"
+                                        "<body>\r\n"
+                                        "  <h2>%s: %s</h2>\r\n"
+                                        "  <p>%s: %s</p>\r\n"
+                                        "</body>\r\n"
+                                        "</html>\r\n",
+                          errnum, shortmsg, longmsg, cause);
+  if (body_len >= MAXBUF)
+    body_len = MAXBUF - 1;
+
+  // Header and body go out in a single write
+  conn->status = atoi(errnum);
+  request_connection_header(conn, connection);
+  int len = sprintf(buf, ""
+                         "HTTP/1.1 %s %s\r\n"
+                         "Content-Type: text/html\r\n"
+                         "%s"
+                         "%s"
+                         "Content-Length: %d\r\n\r\n",
+                    errnum, shortmsg, connection, extra, body_len);
+  memcpy(buf + len, body, body_len);
+  request_write(conn, buf, len + body_len);
+}
+
+void request_error(conn_t *conn, char *cause, char *errnum, char *shortmsg, char *longmsg)
+{
+  request_error_headers(conn, cause, errnum, shortmsg, longmsg, "");
 }
 
 //
-// Reads and discards everything up to an empty text line
+// Decides from the parsed headers whether the client wants a persistent
+// connection (the default for HTTP/1.1, opt-in for HTTP/1.0). Requests
+// carrying a body are never kept alive, since the body is not consumed
 //
-void request_read_headers(int fd)
+void request_parse_headers(conn_t *conn)
 {
-  char buf[MAXBUF];
+  const http_request_t *req = &conn->req;
+  const http_slice_t *value;
+  int wants_keep_alive = conn->http11;
 
-  readline_or_die(fd, buf, MAXBUF);
-  while (strcmp(buf, "\r\n"))
+  if ((value = http_get_header(req, "Connection")))
   {
-    readline_or_die(fd, buf, MAXBUF);
+    if (http_slice_contains(value, "close"))
+      wants_keep_alive = 0;
+    else if (http_slice_contains(value, "keep-alive"))
+      wants_keep_alive = 1;
   }
-  return;
+  if (((value = http_get_header(req, "Content-Length")) && atoi(value->ptr) > 0) ||
+      http_get_header(req, "Transfer-Encoding"))
+  {
+    wants_keep_alive = 0;
+  }
+
+  conn->keep_alive = wants_keep_alive && conn_may_keep_alive(conn);
 }
 
 //
@@ -97,165 +179,459 @@ int request_parse_uri(char *uri, char *filename, char *cgiargs)
 }
 
 //
-// Fills in the filetype given the filename
+// Return 1 if the request is for static content, 0 if dynamic, by the same
+// decision request_handle() makes; the /sql route counts as dynamic
 //
-void request_get_filetype(char *filename, char *filetype)
+int request_is_static(conn_t *conn)
 {
-  if (strstr(filename, ".html"))
-    strcpy(filetype, "text/html");
-  else if (strstr(filename, ".gif"))
-    strcpy(filetype, "image/gif");
-  else if (strstr(filename, ".jpg"))
-    strcpy(filetype, "image/jpeg");
-  else
-    strcpy(filetype, "text/plain");
+  char uri[MAXBUF], filename[MAXBUF], cgiargs[MAXBUF];
+
+  if (http_slice_equals(&conn->req.path, SQL_ROUTE))
+    return 0;
+  http_slice_copy(&conn->req.uri, uri, MAXBUF);
+  return request_parse_uri(uri, filename, cgiargs);
 }
 
-// Thread-safe version of request_serve_dynamic
-void request_serve_dynamic(int fd, char *filename, char *cgiargs)
+//
+// Tells which latency histograms a served request belongs in: static,
+// dynamic, or the statement type of a /sql query; -1 for the stats route,
+// so that watching the server does not skew what it reports
+//
+int request_kind(conn_t *conn)
 {
-  char buf[MAXBUF], *argv[] = {NULL};
+  static const struct
+  {
+    const char *keyword;
+    int kind;
+  } statements[] = {{"SELECT", STATS_SQL_SELECT}, {"INSERT", STATS_SQL_INSERT}, {"UPDATE", STATS_SQL_UPDATE},
+                    {"DELETE", STATS_SQL_DELETE}, {"CREATE", STATS_SQL_CREATE}};
+  char query[64], sql[64];
+
+  if (http_slice_equals(&conn->req.path, STATS_ROUTE))
+    return -1;
+  if (!http_slice_equals(&conn->req.path, SQL_ROUTE))
+    return request_is_static(conn) ? STATS_STATIC : STATS_DYNAMIC;
+
+  // the statement type is the first word; a prefix of the query is enough
+  http_slice_copy(&conn->req.query, query, sizeof(query));
+  sql_url_decode(query, sql, sizeof(sql));
+  char *word = sql;
+  while (isspace((unsigned char)*word))
+    word++;
+  for (size_t i = 0; i < sizeof(statements) / sizeof(statements[0]); i++)
+  {
+    if (strncasecmp(word, statements[i].keyword, 6) == 0)
+      return statements[i].kind;
+  }
+  return STATS_SQL_OTHER;
+}
 
-  // The server does only a little bit of the header.
-  // The CGI script has to finish writing out the header.
-  sprintf(buf, ""
-               "HTTP/1.0 200 OK\r\n"
-               "Server: OSTEP WebServer\r\n");
-
-  write_or_die(fd, buf, strlen(buf));
-
-  // Use mutex to protect fork operation
-  pthread_mutex_lock(&request_mutex);
-  pid_t pid = fork_or_die();
-  pthread_mutex_unlock(&request_mutex);
-
-  if (pid == 0)
-  {                                            // child
-    setenv_or_die("QUERY_STRING", cgiargs, 1); // args to cgi go here
-    dup2_or_die(fd, STDOUT_FILENO);            // make cgi writes go to socket (not screen)
-    extern char **environ;                     // defined by libc
-    execve_or_die(filename, argv, environ);
+typedef ssize_t (*cgi_read_fn)(void *src, void *buf, size_t count);
+
+//
+// Reads CGI output from the pipe of a program started for this request
+//
+ssize_t request_read_pipe(void *src, void *buf, size_t count)
+{
+  return read(*(int *)src, buf, count);
+}
+
+//
+// Copies the output of a CGI program to the client. The CGI program
+// writes its own headers; the server prepends the status line and picks
+// the framing: the program's Content-Length if it sent one, otherwise
+// chunked encoding for HTTP/1.1 clients, otherwise close-delimited.
+// The output comes through read_fn, so that a pipe from a new process and
+// a pooled worker are relayed the same way. A failed read (a pooled worker
+// died or broke the framing) is not the end of the output: the response is
+// left unterminated and the connection closed, so the client sees it is cut short
+//
+void request_relay_cgi(conn_t *conn, cgi_read_fn read_fn, void *src)
+{
+  char buf[MAXBUF + 32], out[2 * MAXBUF], connection[256];
+  int len = 0, header_end = 0, eof = 0, failed = 0;
+
+  // read until the blank line that ends the CGI headers
+  while (!header_end && len < MAXBUF - 1)
+  {
+    ssize_t n = read_fn(src, buf + len, MAXBUF - 1 - len);
+    if (n < 0 && errno == EINTR)
+      continue;
+    if (n <= 0)
+    {
+      eof = 1;
+      failed = n < 0;
+      break;
+    }
+    int old_len = len;
+    len += n;
+    buf[len] = '\0';
+    header_end = find_header_end(buf, len, old_len);
   }
-  else
+
+  if (failed && !header_end)
   {
-    wait_or_die(NULL);
+    conn->keep_alive = 0;
+    request_error(conn, "CGI program", "502", "Bad Gateway", "CGI program failed before sending its headers");
+    return;
+  }
+
+  int has_length = 0, chunked = 0;
+  char *body = buf;
+  int body_len = len;
+  if (header_end)
+  {
+    for (char *line = buf; line < buf + header_end; line = strchr(line, '\n') + 1)
+    {
+      if (strncasecmp(line, "Content-Length:", 15) == 0)
+        has_length = 1;
+    }
+    body = buf + header_end;
+    body_len = len - header_end;
+  }
+
+  char extra[64] = "";
+  if (!header_end && eof)
+  {
+    // program sent no headers; the whole output is the body
+    sprintf(extra, "Content-Length: %d\r\n\r\n", len);
+    has_length = 1;
+  }
+  else if (!header_end)
+  {
+    strcpy(extra, "\r\n");
+  }
+
+  if (!has_length && conn->http11 && conn->keep_alive)
+    chunked = 1;
+  else if (!has_length)
+    conn->keep_alive = 0;
+
+  conn->status = 200;
+  request_connection_header(conn, connection);
+  int out_len = sprintf(out, ""
+                             "HTTP/1.1 200 OK\r\n"
+                             "Server: OSTEP WebServer\r\n"
+                             "%s%s%s",
+                        connection, chunked ? "Transfer-Encoding: chunked\r\n" : "", extra);
+  memcpy(out + out_len, buf, header_end);
+  out_len += header_end;
+  request_write(conn, out, out_len);
+
+  // relay the body, framing each read as one chunk if needed;
+  // buf + 16 leaves room to prepend the chunk size line in place
+  memmove(buf + 16, body, body_len);
+  while (1)
+  {
+    if (body_len > 0)
+    {
+      if (chunked)
+      {
+        char size_line[16];
+        int size_len = sprintf(size_line, "%x\r\n", body_len);
+        memcpy(buf + 16 - size_len, size_line, size_len);
+        memcpy(buf + 16 + body_len, "\r\n", 2);
+        request_write(conn, buf + 16 - size_len, size_len + body_len + 2);
+      }
+      else
+      {
+        request_write(conn, buf + 16, body_len);
+      }
+    }
+    if (eof)
+      break;
+
+    ssize_t n = read_fn(src, buf + 16, MAXBUF);
+    if (n < 0 && errno == EINTR)
+      continue;
+    if (n < 0)
+    {
+      failed = 1;
+      break;
+    }
+    if (n == 0)
+    {
+      eof = 1;
+      body_len = 0;
+      continue;
+    }
+    body_len = n;
   }
+
+  if (failed)
+    conn->keep_alive = 0;
+  else if (chunked)
+    request_write(conn, "0\r\n\r\n", 5);
 }
 
-void request_serve_static(int fd, char *filename, int filesize)
+// Thread-safe version of request_serve_dynamic
+void request_serve_dynamic(conn_t *conn, char *filename, char *cgiargs)
 {
-  int srcfd;
-  char *srcp, filetype[MAXBUF], buf[MAXBUF];
+  char query[MAXBUF + 16];
+  int pipe_fd[2];
+
+  // Hand the request to a pooled worker when there is one (-c);
+  // a worker that died while idle falls back to a new process
+  cgi_proc_t *proc = cgi_pool_acquire(filename);
+  if (proc)
+  {
+    int sent = cgi_pool_send(proc, cgiargs) == 0;
+    if (sent)
+      request_relay_cgi(conn, cgi_pool_read, proc);
+    cgi_pool_release(proc);
+    if (sent)
+      return;
+  }
 
-  request_get_filetype(filename, filetype);
-  srcfd = open_or_die(filename, O_RDONLY, 0);
+  // The CGI output goes through a pipe so that the server can frame it
+  // for a persistent connection; running out of descriptors fails only
+  // this request
+  if (pipe2(pipe_fd, O_CLOEXEC) < 0)
+  {
+    request_error(conn, filename, "500", "Internal Server Error", "server could not start this CGI program");
+    return;
+  }
+
+  // No lock needed: posix_spawn() sets up the child without running any
+  // server code in it, so concurrent launches proceed in parallel
+  posix_spawn_file_actions_t actions;
+  posix_spawn_file_actions_init(&actions);
+  posix_spawn_file_actions_adddup2(&actions, pipe_fd[1], STDOUT_FILENO); // make cgi writes go to the pipe (not screen)
+  sprintf(query, "QUERY_STRING=%s", cgiargs);                             // args to cgi go here
+  pid_t pid = cgi_spawn(filename, query, &actions);
+  posix_spawn_file_actions_destroy(&actions);
+  close_or_die(pipe_fd[1]);
+
+  if (pid < 0)
+  {
+    close_or_die(pipe_fd[0]);
+    request_error(conn, filename, "500", "Internal Server Error", "server could not start this CGI program");
+    return;
+  }
+
+  request_relay_cgi(conn, request_read_pipe, &pipe_fd[0]);
+  close_or_die(pipe_fd[0]);
+  waitpid(pid, NULL, 0); // not wait(): that could reap a pooled worker
+}
+
+//
+// Runs a SQL command on the worker thread with the linked-in engine,
+// which saves the fork/exec/wait of cgi-bin/sql.cgi
+//
+void request_serve_sql(conn_t *conn, char *cgiargs)
+{
+  char sql[MAX_QUERY_LEN], buf[MAXBUF], connection[256];
+  SqlOutput out;
 
-  // Rather than call read() to read the file into memory,
-  // which would require that we allocate a buffer, we memory-map the file
-  srcp = mmap_or_die(0, filesize, PROT_READ, MAP_PRIVATE, srcfd, 0);
-  close_or_die(srcfd);
+  sql_output_init(&out);
+  sql_url_decode(cgiargs, sql, MAX_QUERY_LEN);
+  sql_execute(sql, &out);
 
-  // put together response
+  conn->status = 200;
+  request_connection_header(conn, connection);
   sprintf(buf, ""
-               "HTTP/1.0 200 OK\r\n"
+               "HTTP/1.1 200 OK\r\n"
                "Server: OSTEP WebServer\r\n"
+               "%s"
                "Content-Length: %d\r\n"
                "Content-Type: %s\r\n\r\n",
-          filesize, filetype);
-
-  write_or_die(fd, buf, strlen(buf));
+          connection, out.body.len, out.content_type);
 
-  //  Writes out to the client socket the memory-mapped file
-  write_or_die(fd, srcp, filesize);
-  munmap_or_die(srcp, filesize);
+  struct iovec iov[2] = {{buf, strlen(buf)}, {out.body.data, out.body.len}};
+  request_writev(conn, iov, 2);
+  sql_output_free(&out);
 }
 
-// New function to estimate file size for SFF scheduling
-int request_get_filesize(int fd)
+//
+// Applies a log_sample=N parameter of the stats route, so the access log's
+// sampling rate can be changed while the server runs; returns -1 if N is not
+// a whole number from 0 (log nothing) to INT_MAX, 0 otherwise
+//
+static int request_stats_log_sample(conn_t *conn)
 {
-  char buf[MAXBUF], method[MAXBUF], uri[MAXBUF], version[MAXBUF];
-  char filename[MAXBUF], cgiargs[MAXBUF];
-  struct stat sbuf;
+  char query[MAXBUF];
+  http_slice_copy(&conn->req.query, query, sizeof(query));
 
-  // Read the request line
-  int n = recv(fd, buf, MAXBUF - 1, MSG_PEEK);
-  if (n <= 0)
+  char *value = query;
+  while ((value = strstr(value, STATS_LOG_SAMPLE)) && value != query && value[-1] != '&')
+    value++;
+  if (!value)
     return 0;
 
-  // Find the end of the first line
-  char *end = strstr(buf, "\r\n");
-  if (!end)
-    return n; // If can't parse, return request size
+  value += strlen(STATS_LOG_SAMPLE);
+  char *end;
+  errno = 0;
+  long long sample = strtoll(value, &end, 10);
+  if (errno != 0 || end == value || (*end != '\0' && *end != '&') || sample < 0 || sample > INT_MAX)
+    return -1;
+  access_log_set_sample((int)sample);
+  return 0;
+}
 
-  // Extract method, URI, and version
-  buf[end - buf] = '\0';
-  sscanf(buf, "%s %s %s", method, uri, version);
+//
+// Answers the stats route; every thread's counters are summed only here, so
+// the threads that count never contend with each other or with this
+//
+void request_serve_stats(conn_t *conn)
+{
+  char buf[MAXBUF], connection[256];
+  int prometheus = http_slice_contains(&conn->req.query, "format=prometheus");
+  int len;
 
-  // Parse URI to get filename
-  int is_static = request_parse_uri(uri, filename, cgiargs);
+  if (request_stats_log_sample(conn) < 0)
+  {
+    request_error(conn, STATS_ROUTE, "400", "Bad Request", "log_sample must be a whole number of 0 or more");
+    return;
+  }
 
-  // If it's a CGI script with a parameter, use that as the size estimate
-  if (!is_static && strstr(filename, "spin.cgi") && strlen(cgiargs) > 0)
+  char *body = stats_render(prometheus, &len);
+  if (!body)
   {
-    return atoi(cgiargs) * 1000; // Scale up for better differentiation
+    request_error(conn, STATS_ROUTE, "500", "Internal Server Error", "server could not collect its statistics");
+    return;
   }
 
-  // For static files, try to get the actual file size
-  if (stat(filename, &sbuf) >= 0)
+  conn->status = 200;
+  request_connection_header(conn, connection);
+  sprintf(buf, ""
+               "HTTP/1.1 200 OK\r\n"
+               "Server: OSTEP WebServer\r\n"
+               "%s"
+               "Content-Length: %d\r\n"
+               "Content-Type: %s\r\n\r\n",
+          connection, len, prometheus ? "text/plain; version=0.0.4" : "application/json");
+
+  struct iovec iov[2] = {{buf, strlen(buf)}, {body, len}};
+  request_writev(conn, iov, 2);
+  free(body);
+}
+
+//
+// Sends a static file from the file cache. Small files are in memory and go
+// out together with their headers in one writev(); larger ones are sent from
+// the cached descriptor with sendfile(), so the body is copied to the socket
+// inside the kernel, behind headers sent with MSG_MORE so they leave in the
+// same packet as the start of the body
+//
+void request_serve_static(conn_t *conn, file_entry_t *file)
+{
+  char buf[MAXBUF], connection[256];
+
+  conn->status = 200;
+  request_connection_header(conn, connection);
+  strcat(connection, "\r\n");
+
+  if (file->body)
   {
-    return sbuf.st_size;
+    struct iovec iov[3] = {{file->header, file->header_len},
+                           {connection, strlen(connection)},
+                           {file->body, file->size}};
+    request_writev(conn, iov, 3);
+    return;
   }
 
-  // Default: return the request size
-  return n;
+  int len = sprintf(buf, "%s%s", file->header, connection);
+  if (!conn->trace.first_byte_us)
+    conn->trace.first_byte_us = now_usec();
+  if (sendn(conn->fd, buf, len, MSG_MORE) < 0 ||
+      sendfilen(conn->fd, file->fd, 0, file->size) < 0)
+  {
+    // the client went away, or the file shrank and the response is short
+    conn->keep_alive = 0;
+    return;
+  }
+  conn->bytes_sent += len + file->size;
 }
 
 // Handle a request - thread-safe version
-void request_handle(int fd)
+void request_handle(conn_t *conn)
 {
   int is_static;
   struct stat sbuf;
-  char buf[MAXBUF], method[MAXBUF], uri[MAXBUF], version[MAXBUF];
+  char method[MAXBUF], uri[MAXBUF], version[MAXBUF];
   char filename[MAXBUF], cgiargs[MAXBUF];
 
-  readline_or_die(fd, buf, MAXBUF);
-  sscanf(buf, "%s %s %s", method, uri, version);
+  // the reactor has already parsed the request line and headers
+  http_slice_copy(&conn->req.method, method, MAXBUF);
+  http_slice_copy(&conn->req.uri, uri, MAXBUF);
+  http_slice_copy(&conn->req.version, version, MAXBUF);
 
-  // Using mutex to protect printf
-  pthread_mutex_lock(&request_mutex);
-  printf("method:%s uri:%s version:%s\n", method, uri, version);
-  pthread_mutex_unlock(&request_mutex);
+  // the access log is written by a background thread (access_log.c), so no
+  // lock is taken here; it reads the status and byte count set while serving
+  conn->status = 0;
+  conn->bytes_sent = 0;
+  conn->http11 = strcasecmp(version, "HTTP/1.1") == 0;
+  conn->keep_alive = 0;
 
   if (strcasecmp(method, "GET"))
   {
-    request_error(fd, method, "501", "Not Implemented", "server does not implement this method");
+    request_error(conn, method, "501", "Not Implemented", "server does not implement this method");
     return;
   }
-  request_read_headers(fd);
+  request_parse_headers(conn);
 
-  is_static = request_parse_uri(uri, filename, cgiargs);
-  if (stat(filename, &sbuf) < 0)
+  if (http_slice_equals(&conn->req.path, STATS_ROUTE))
   {
-    request_error(fd, filename, "404", "Not found", "server could not find this file");
+    request_serve_stats(conn);
     return;
   }
 
+  if (http_slice_equals(&conn->req.path, SQL_ROUTE))
+  {
+    http_slice_copy(&conn->req.query, cgiargs, MAXBUF);
+    request_serve_sql(conn, cgiargs);
+    return;
+  }
+
+  is_static = request_parse_uri(uri, filename, cgiargs);
   if (is_static)
   {
-    if (!(S_ISREG(sbuf.st_mode)) || !(S_IRUSR & sbuf.st_mode))
+    file_entry_t *file;
+    if (file_cache_get(filename, &file) < 0)
     {
-      request_error(fd, filename, "403", "Forbidden", "server could not read this file");
+      if (errno == ENOENT || errno == ENOTDIR || errno == ENAMETOOLONG)
+        request_error(conn, filename, "404", "Not found", "server could not find this file");
+      else
+        request_error(conn, filename, "403", "Forbidden", "server could not read this file");
       return;
     }
-    request_serve_static(fd, filename, sbuf.st_size);
+    request_serve_static(conn, file);
+    file_cache_put(file);
+    return;
   }
-  else
+
+  if (stat(filename, &sbuf) < 0)
   {
-    if (!(S_ISREG(sbuf.st_mode)) || !(S_IXUSR & sbuf.st_mode))
-    {
-      request_error(fd, filename, "403", "Forbidden", "server could not run this CGI program");
-      return;
-    }
-    request_serve_dynamic(fd, filename, cgiargs);
+    request_error(conn, filename, "404", "Not found", "server could not find this file");
+    return;
+  }
+  if (!(S_ISREG(sbuf.st_mode)) || !(S_IXUSR & sbuf.st_mode))
+  {
+    request_error(conn, filename, "403", "Forbidden", "server could not run this CGI program");
+    return;
   }
-}
\ No newline at end of file
+  request_serve_dynamic(conn, filename, cgiargs);
+}
+
+//
+// Answers a request with 503 without serving it; used for requests the
+// scheduler drops, so it does no file or CGI work. With retry_after > 0 the
+// server is shedding load: the client is told when to retry and the
+// connection is closed so that it stops taking a slot
+//
+void request_reject(conn_t *conn, char *cause, char *longmsg, int retry_after)
+{
+  char version[MAXBUF], extra[64] = "";
+
+  http_slice_copy(&conn->req.version, version, MAXBUF);
+  conn->http11 = strcasecmp(version, "HTTP/1.1") == 0;
+  conn->status = 0;
+  conn->bytes_sent = 0;
+  request_parse_headers(conn);
+  if (retry_after > 0)
+  {
+    conn->keep_alive = 0;
+    sprintf(extra, "Retry-After: %d\r\n", retry_after);
+  }
+  request_error_headers(conn, cause, "503", "Service Unavailable", longmsg, extra);
+}
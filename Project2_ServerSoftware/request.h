@@ -1,7 +1,12 @@
 #ifndef __REQUEST_H__
 #define __REQUEST_H__
 
-void request_handle(int fd);
-int request_get_filesize(int fd);
+#include "reactor.h"
+
+void request_handle(conn_t *conn);
+int request_is_static(conn_t *conn);
+int request_kind(conn_t *conn);
+void request_error(conn_t *conn, char *cause, char *errnum, char *shortmsg, char *longmsg);
+void request_reject(conn_t *conn, char *cause, char *longmsg, int retry_after);
 
 #endif // __REQUEST_H__
\ No newline at end of file
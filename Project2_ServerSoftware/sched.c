@@ -0,0 +1,81 @@
+#include <strings.h>
+#include "sched.h"
+
+// every policy that -s accepts
+static const sched_ops_t *sched_policies[] = {
+    &sched_fifo_ops,
+    &sched_sff_ops,
+    &sched_sff_aging_ops,
+    &sched_sjf_ops,
+    &sched_edf_ops,
+    &sched_drr_ops,
+};
+
+/**
+ * looks up a scheduling policy by name, ignoring case
+ *
+ * @param name the value of -s
+ * @return the policy, or NULL if there is none by that name
+ */
+const sched_ops_t *sched_find(const char *name)
+{
+  for (size_t i = 0; i < sizeof(sched_policies) / sizeof(sched_policies[0]); i++)
+  {
+    if (strcasecmp(sched_policies[i]->name, name) == 0)
+      return sched_policies[i];
+  }
+  return NULL;
+}
+
+/**
+ * creates an empty queue run by the given policy
+ *
+ * @param s the queue to initialize
+ * @param ops the scheduling policy
+ * @param capacity maximum number of waiting requests
+ * @return 0 on success, -1 if memory could not be allocated
+ */
+int sched_init(sched_t *s, const sched_ops_t *ops, int capacity)
+{
+  s->ops = ops;
+  s->impl = NULL;
+  return ops->init(s, capacity);
+}
+
+/**
+ * adds a request without blocking
+ *
+ * @return 0 on success, -1 if the queue is full
+ */
+int sched_enqueue(sched_t *s, const request_t *request)
+{
+  return s->ops->enqueue(s, request);
+}
+
+/**
+ * takes the request the policy picks next without blocking
+ *
+ * @return 0 on success, -1 if the queue is empty
+ */
+int sched_dequeue(sched_t *s, request_t *request)
+{
+  return s->ops->dequeue(s, request);
+}
+
+/**
+ * looks at the request the policy would pick next without taking it
+ * only a snapshot: another thread may dequeue and finish the request right
+ * after this returns, so request->conn must not be dereferenced unless the
+ * caller is the queue's only consumer
+ *
+ * @return 0 on success, -1 if the queue is empty
+ */
+int sched_peek(sched_t *s, request_t *request)
+{
+  return s->ops->peek(s, request);
+}
+
+void sched_stats(sched_t *s, sched_stats_t *stats)
+{
+  s->ops->stats(s, stats);
+}
@@ -0,0 +1,87 @@
+#ifndef __SCHED_H__
+#define __SCHED_H__
+
+#include "reactor.h"
+
+// default aging settings for SFF-AGING
+#define DEFAULT_SCHED_AGING_RATE 1000   // estimated bytes forgiven per second waited (-a)
+#define DEFAULT_SCHED_MAX_WAIT_MS 10000 // a request waiting this long goes next (-w), 0 for no limit
+
+#define DEFAULT_SCHED_DEADLINE_MS 10000 // EDF deadline of a request without X-Deadline-Ms (-e)
+#define SCHED_MAX_DEADLINE_MS 86400000LL // longest X-Deadline-Ms accepted, one day
+
+#define SCHED_CLASSES 4 // wait time classes, by estimated size, predicted usec or deadline budget in usec: < 1K, < 16K, < 256K, larger
+
+// a request waiting for a worker
+typedef struct
+{
+  conn_t *conn;                 // client connection with its buffered request
+  int filesize;                 // SFF scheduling
+  unsigned long long job_class; // SJF scheduling: hash of the request's class, 0 if not classified
+  long long predicted_us;       // SJF scheduling: predicted service time
+  long long enqueued_us;        // monotonic time the request was queued
+  long long deadline_us;        // EDF scheduling: monotonic time the response is due
+  int expires;                  // EDF scheduling: the client set the deadline, drop the request once it passes
+  unsigned long long tenant;    // DRR scheduling: hash of the client's API key or address
+} request_t;
+
+// how long the requests of one class waited in the queue
+typedef struct
+{
+  long long enqueued;
+  long long dequeued;
+  long long wait_total_us; // summed over the dequeued requests
+  long long wait_max_us;
+} sched_class_stats_t;
+
+// counters reported by a scheduler; only a snapshot while other threads
+// are adding or taking requests
+typedef struct
+{
+  long long enqueued; // requests added since startup
+  long long dequeued; // requests taken since startup
+  int depth;          // requests waiting now
+  sched_class_stats_t classes[SCHED_CLASSES]; // all zero for policies without wait times
+} sched_stats_t;
+
+struct sched;
+
+// a scheduling policy (-s); none of the operations block, and each
+// implementation does its own locking so any thread may call them
+typedef struct
+{
+  const char *name;
+  int (*init)(struct sched *s, int capacity);
+  int (*enqueue)(struct sched *s, const request_t *request);
+  int (*dequeue)(struct sched *s, request_t *request);
+  int (*peek)(struct sched *s, request_t *request);
+  void (*stats)(struct sched *s, sched_stats_t *stats);
+} sched_ops_t;
+
+// a bounded queue of waiting requests, ordered by its policy
+typedef struct sched
+{
+  const sched_ops_t *ops;
+  void *impl; // the policy's own state
+} sched_t;
+
+extern const sched_ops_t sched_fifo_ops;
+extern const sched_ops_t sched_sff_ops;
+extern const sched_ops_t sched_sff_aging_ops;
+extern const sched_ops_t sched_sjf_ops;
+extern const sched_ops_t sched_edf_ops;
+extern const sched_ops_t sched_drr_ops;
+
+// aging settings (-a and -w) and the default EDF deadline (-e)
+extern long long sched_aging_rate;
+extern int sched_max_wait_ms;
+extern int sched_default_deadline_ms;
+
+const sched_ops_t *sched_find(const char *name);
+int sched_init(sched_t *s, const sched_ops_t *ops, int capacity);
+int sched_enqueue(sched_t *s, const request_t *request);
+int sched_dequeue(sched_t *s, request_t *request);
+int sched_peek(sched_t *s, request_t *request);
+void sched_stats(sched_t *s, sched_stats_t *stats);
+
+#endif // __SCHED_H__
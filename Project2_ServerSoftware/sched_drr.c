@@ -0,0 +1,296 @@
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include "sched.h"
+
+// Deficit Round Robin: every tenant (client address or API key) has its own
+// FIFO sub-queue, and the tenants with waiting requests take turns. On its
+// turn a tenant earns DRR_QUANTUM of credit and is served while its credit
+// covers the estimated size of its next request, so a tenant gets an equal
+// share of the workers however many requests it queues
+
+// default DRR settings
+#define DRR_QUANTUM 1024 // estimated bytes of credit a tenant earns per turn, about one small request
+
+typedef struct
+{
+  request_t request;
+  int next; // next request of the same tenant, or next free node
+} drr_node_t;
+
+typedef struct
+{
+  unsigned long long tenant;
+  int head, tail;    // the tenant's requests, oldest first
+  long long deficit; // credit left from earlier turns
+  int turn;          // the tenant is at the front and has had its quantum
+  int hnext;         // hash chain, or next free flow
+  int next;          // next tenant in the active list
+} drr_flow_t;
+
+typedef struct
+{
+  pthread_mutex_t mutex;
+  drr_node_t *nodes; // capacity request nodes
+  drr_flow_t *flows; // capacity flows, at most one per waiting request
+  int *buckets;      // flow hash table, -1 terminated chains
+  int num_buckets;   // a power of two
+  int free_nodes, free_flows;
+  int active, active_tail; // tenants with waiting requests, in turn order
+  int active_count;
+  int count;
+  int capacity;
+  long long enqueued, dequeued;
+} drr_t;
+
+static int drr_init(sched_t *s, int capacity)
+{
+  drr_t *d = (drr_t *)calloc(1, sizeof(drr_t));
+  if (!d)
+    return -1;
+  d->num_buckets = 1;
+  while (d->num_buckets < capacity)
+    d->num_buckets *= 2;
+  d->nodes = (drr_node_t *)malloc(capacity * sizeof(drr_node_t));
+  d->flows = (drr_flow_t *)malloc(capacity * sizeof(drr_flow_t));
+  d->buckets = (int *)malloc(d->num_buckets * sizeof(int));
+  if (!d->nodes || !d->flows || !d->buckets)
+  {
+    free(d->nodes);
+    free(d->flows);
+    free(d->buckets);
+    free(d);
+    return -1;
+  }
+  for (int i = 0; i < capacity; i++)
+  {
+    d->nodes[i].next = i + 1 < capacity ? i + 1 : -1;
+    d->flows[i].hnext = i + 1 < capacity ? i + 1 : -1;
+  }
+  for (int i = 0; i < d->num_buckets; i++)
+    d->buckets[i] = -1;
+  pthread_mutex_init(&d->mutex, NULL);
+  d->active = d->active_tail = -1;
+  d->capacity = capacity;
+  s->impl = d;
+  return 0;
+}
+
+/**
+ * the credit a request needs; every request costs something, so a tenant of
+ * empty estimates cannot be served endlessly on one turn
+ */
+static long long drr_cost(const request_t *request)
+{
+  return request->filesize > 0 ? request->filesize : 1;
+}
+
+static int *drr_bucket(drr_t *d, unsigned long long tenant)
+{
+  return &d->buckets[tenant & (d->num_buckets - 1)];
+}
+
+static int drr_enqueue(sched_t *s, const request_t *request)
+{
+  drr_t *d = (drr_t *)s->impl;
+  int rc = -1;
+
+  pthread_mutex_lock(&d->mutex);
+  if (d->count < d->capacity)
+  {
+    int node = d->free_nodes;
+    d->free_nodes = d->nodes[node].next;
+    d->nodes[node].request = *request;
+    d->nodes[node].next = -1;
+
+    int *bucket = drr_bucket(d, request->tenant);
+    int f = *bucket;
+    while (f >= 0 && d->flows[f].tenant != request->tenant)
+      f = d->flows[f].hnext;
+
+    if (f >= 0)
+    {
+      d->nodes[d->flows[f].tail].next = node;
+      d->flows[f].tail = node;
+    }
+    else
+    {
+      // a tenant with nothing waiting joins at the back of the turn order
+      f = d->free_flows;
+      d->free_flows = d->flows[f].hnext;
+      drr_flow_t *flow = &d->flows[f];
+      flow->tenant = request->tenant;
+      flow->head = flow->tail = node;
+      flow->deficit = 0;
+      flow->turn = 0;
+      flow->hnext = *bucket;
+      *bucket = f;
+      flow->next = -1;
+      if (d->active_tail >= 0)
+        d->flows[d->active_tail].next = f;
+      else
+        d->active = f;
+      d->active_tail = f;
+      d->active_count++;
+    }
+    d->count++;
+    d->enqueued++;
+    rc = 0;
+  }
+  pthread_mutex_unlock(&d->mutex);
+  return rc;
+}
+
+/**
+ * ends the turn of the tenant at the front, moving it to the back
+ */
+static void drr_rotate(drr_t *d)
+{
+  int f = d->active;
+  d->flows[f].turn = 0;
+  if (d->active_tail == f)
+    return;
+  d->active = d->flows[f].next;
+  d->flows[f].next = -1;
+  d->flows[d->active_tail].next = f;
+  d->active_tail = f;
+}
+
+/**
+ * removes the tenant at the front, whose last request was just taken; a
+ * tenant that goes idle keeps no credit
+ */
+static void drr_retire(drr_t *d)
+{
+  int f = d->active;
+  d->active = d->flows[f].next;
+  if (d->active < 0)
+    d->active_tail = -1;
+  d->active_count--;
+
+  int *link = drr_bucket(d, d->flows[f].tenant);
+  while (*link != f)
+    link = &d->flows[*link].hnext;
+  *link = d->flows[f].hnext;
+  d->flows[f].hnext = d->free_flows;
+  d->free_flows = f;
+}
+
+/**
+ * finds the tenant that will be served next: each tenant needs a number of
+ * further turns to cover its next request, and the turns come round in active
+ * list order. Must be called with the mutex held and a request waiting
+ *
+ * @param rounds receives the full rounds of turns that pass before it is served
+ * @param position receives its position in the active list
+ * @return the tenant's flow
+ */
+static int drr_pick(drr_t *d, long long *rounds, int *position)
+{
+  long long best_visit = -1;
+  int best = -1, index = 0;
+  for (int f = d->active; f >= 0; f = d->flows[f].next, index++)
+  {
+    drr_flow_t *flow = &d->flows[f];
+    long long credit = flow->deficit + (flow->turn ? 0 : DRR_QUANTUM);
+    long long cost = drr_cost(&d->nodes[flow->head].request);
+    long long need = cost <= credit ? 0 : (cost - credit + DRR_QUANTUM - 1) / DRR_QUANTUM;
+    long long visit = need * d->active_count + index;
+    if (best_visit < 0 || visit < best_visit)
+    {
+      best_visit = visit;
+      best = f;
+      *rounds = need;
+      *position = index;
+    }
+  }
+  return best;
+}
+
+/**
+ * takes the request drr_pick() finds, handing out at once the credit the
+ * turns before it would have: every tenant earns a quantum for each full
+ * round, and those ahead of the chosen one a further quantum for the round
+ * in which it is served, so a large request costs no more work than a small one
+ */
+static int drr_dequeue(sched_t *s, request_t *request)
+{
+  drr_t *d = (drr_t *)s->impl;
+  int rc = -1;
+
+  pthread_mutex_lock(&d->mutex);
+  if (d->count > 0)
+  {
+    long long rounds = 0;
+    int position = 0;
+    int chosen = drr_pick(d, &rounds, &position);
+
+    int index = 0;
+    for (int f = d->active; f >= 0; f = d->flows[f].next, index++)
+    {
+      drr_flow_t *flow = &d->flows[f];
+      long long turns = index <= position ? rounds + 1 : rounds;
+      if (index == 0 && flow->turn)
+        turns--; // the tenant at the front already has this turn's quantum
+      flow->deficit += turns * DRR_QUANTUM;
+    }
+
+    // the tenants passed over go to the back, and the chosen one has its turn
+    while (d->active != chosen)
+      drr_rotate(d);
+    drr_flow_t *flow = &d->flows[chosen];
+    flow->turn = 1;
+
+    int node = flow->head;
+    flow->deficit -= drr_cost(&d->nodes[node].request);
+    *request = d->nodes[node].request;
+    flow->head = d->nodes[node].next;
+    d->nodes[node].next = d->free_nodes;
+    d->free_nodes = node;
+    if (flow->head < 0)
+      drr_retire(d);
+    d->count--;
+    d->dequeued++;
+    rc = 0;
+  }
+  pthread_mutex_unlock(&d->mutex);
+  return rc;
+}
+
+static int drr_peek(sched_t *s, request_t *request)
+{
+  drr_t *d = (drr_t *)s->impl;
+  int rc = -1;
+
+  pthread_mutex_lock(&d->mutex);
+  if (d->count > 0)
+  {
+    long long rounds;
+    int position;
+    *request = d->nodes[d->flows[drr_pick(d, &rounds, &position)].head].request;
+    rc = 0;
+  }
+  pthread_mutex_unlock(&d->mutex);
+  return rc;
+}
+
+static void drr_stats(sched_t *s, sched_stats_t *stats)
+{
+  drr_t *d = (drr_t *)s->impl;
+
+  memset(stats->classes, 0, sizeof(stats->classes));
+  pthread_mutex_lock(&d->mutex);
+  stats->enqueued = d->enqueued;
+  stats->dequeued = d->dequeued;
+  stats->depth = d->count;
+  pthread_mutex_unlock(&d->mutex);
+}
+
+const sched_ops_t sched_drr_ops = {
+    .name = "DRR",
+    .init = drr_init,
+    .enqueue = drr_enqueue,
+    .dequeue = drr_dequeue,
+    .peek = drr_peek,
+    .stats = drr_stats,
+};
@@ -0,0 +1,86 @@
+#include <stdlib.h>
+#include <string.h>
+#include "sched.h"
+#include "mpmc.h"
+
+// First-In-First-Out needs no ordering beyond arrival, so it runs on the
+// lock-free ring; requests are stored as bare connection pointers, and the
+// time a request was queued is kept in its connection
+
+static int fifo_init(sched_t *s, int capacity)
+{
+  mpmc_ring_t *ring = (mpmc_ring_t *)aligned_alloc(CACHE_LINE, sizeof(mpmc_ring_t));
+  if (!ring)
+    return -1;
+  if (mpmc_ring_init(ring, capacity) < 0)
+  {
+    free(ring);
+    return -1;
+  }
+  s->impl = ring;
+  return 0;
+}
+
+static int fifo_enqueue(sched_t *s, const request_t *request)
+{
+  return mpmc_ring_push((mpmc_ring_t *)s->impl, request->conn);
+}
+
+static int fifo_dequeue(sched_t *s, request_t *request)
+{
+  void *item;
+  if (mpmc_ring_pop((mpmc_ring_t *)s->impl, &item) < 0)
+    return -1;
+  request->conn = (conn_t *)item;
+  request->filesize = 0;
+  request->job_class = 0;
+  request->predicted_us = 0;
+  request->enqueued_us = request->conn->queued_us;
+  request->deadline_us = 0;
+  request->expires = 0;
+  request->tenant = 0;
+  return 0;
+}
+
+/**
+ * a worker may pop and finish the peeked connection at any moment, so only
+ * its pointer is returned and the connection itself is never read; the
+ * time it was queued is unknown and left 0
+ */
+static int fifo_peek(sched_t *s, request_t *request)
+{
+  void *item;
+  if (mpmc_ring_peek((mpmc_ring_t *)s->impl, &item) < 0)
+    return -1;
+  request->conn = (conn_t *)item;
+  request->filesize = 0;
+  request->job_class = 0;
+  request->predicted_us = 0;
+  request->enqueued_us = 0;
+  request->deadline_us = 0;
+  request->expires = 0;
+  request->tenant = 0;
+  return 0;
+}
+
+/**
+ * reads the counters off the ring: every push advances head and every pop
+ * advances tail, so the ring needs no counters of its own
+ */
+static void fifo_stats(sched_t *s, sched_stats_t *stats)
+{
+  mpmc_ring_t *ring = (mpmc_ring_t *)s->impl;
+  memset(stats->classes, 0, sizeof(stats->classes));
+  stats->dequeued = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+  stats->enqueued = atomic_load_explicit(&ring->head, memory_order_relaxed);
+  stats->depth = stats->enqueued > stats->dequeued ? (int)(stats->enqueued - stats->dequeued) : 0;
+}
+
+const sched_ops_t sched_fifo_ops = {
+    .name = "FIFO",
+    .init = fifo_init,
+    .enqueue = fifo_enqueue,
+    .dequeue = fifo_dequeue,
+    .peek = fifo_peek,
+    .stats = fifo_stats,
+};
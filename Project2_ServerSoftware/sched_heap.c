@@ -0,0 +1,361 @@
+#include <pthread.h>
+#include <stdlib.h>
+#include "sched.h"
+#include "io_helper.h"
+
+// policies that always pick the waiting request with the smallest key keep
+// their requests in a binary min-heap, so adding and taking a request costs
+// O(log n) however many requests wait; equal keys are served in arrival order.
+// Requests are also linked in arrival order, so a policy with a maximum wait
+// can find and take the oldest request in O(log n) as well
+
+typedef long long (*heap_key_fn)(const request_t *request);
+
+// aging settings (-a and -w)
+long long sched_aging_rate = DEFAULT_SCHED_AGING_RATE;
+int sched_max_wait_ms = DEFAULT_SCHED_MAX_WAIT_MS;
+int sched_default_deadline_ms = DEFAULT_SCHED_DEADLINE_MS;
+
+typedef struct
+{
+  long long key;
+  unsigned long long seq; // arrival order, breaks ties between equal keys
+  int cls;                // wait time class
+  int heap_pos;           // index in heap
+  int prev, next;         // arrival list, -1 at the ends; next also links free nodes
+  request_t request;
+} heap_node_t;
+
+typedef struct
+{
+  pthread_mutex_t mutex;
+  heap_node_t *nodes; // node pool, capacity entries
+  int *heap;          // node indices; heap[0] is the next request to serve
+  int count;
+  int capacity;
+  int free_list;
+  int oldest, newest; // ends of the arrival list, -1 when empty
+  unsigned long long next_seq;
+  long long dequeued;
+  heap_key_fn key;
+  heap_key_fn class_key; // value that picks the wait time class
+  long long aging_rate;  // key units forgiven per second waited, 0 for no aging
+  long long max_wait_us; // a request waiting this long goes next, 0 for no limit
+  sched_class_stats_t classes[SCHED_CLASSES];
+} heap_t;
+
+static int heap_before(const heap_t *h, int a, int b)
+{
+  const heap_node_t *x = &h->nodes[a];
+  const heap_node_t *y = &h->nodes[b];
+  return x->key < y->key || (x->key == y->key && x->seq < y->seq);
+}
+
+static void heap_place(heap_t *h, int pos, int node)
+{
+  h->heap[pos] = node;
+  h->nodes[node].heap_pos = pos;
+}
+
+/**
+ * moves the node at heap index i up until its parent comes before it
+ */
+static void heap_sift_up(heap_t *h, int i)
+{
+  int node = h->heap[i];
+  while (i > 0)
+  {
+    int parent = (i - 1) / 2;
+    if (!heap_before(h, node, h->heap[parent]))
+      break;
+    heap_place(h, i, h->heap[parent]);
+    i = parent;
+  }
+  heap_place(h, i, node);
+}
+
+/**
+ * moves the node at heap index i down until it comes before both children
+ */
+static void heap_sift_down(heap_t *h, int i)
+{
+  int node = h->heap[i];
+  while (1)
+  {
+    int child = 2 * i + 1;
+    if (child >= h->count)
+      break;
+    if (child + 1 < h->count && heap_before(h, h->heap[child + 1], h->heap[child]))
+      child++;
+    if (!heap_before(h, h->heap[child], node))
+      break;
+    heap_place(h, i, h->heap[child]);
+    i = child;
+  }
+  heap_place(h, i, node);
+}
+
+/**
+ * maps a class key to its wait time class: each class covers values 16 times
+ * larger than the one before, starting below 1024
+ */
+static int heap_class(long long key)
+{
+  int cls = 0;
+  for (long long limit = 1024; key >= limit && cls < SCHED_CLASSES - 1; limit *= 16)
+    cls++;
+  return cls;
+}
+
+/**
+ * takes a node out of the heap and the arrival list, returns it to the free
+ * list and records how long it waited; must be called with the mutex held
+ */
+static void heap_remove(heap_t *h, int node, request_t *request, long long now)
+{
+  heap_node_t *n = &h->nodes[node];
+  int pos = n->heap_pos;
+
+  if (--h->count > pos)
+  {
+    // the last node fills the hole and may belong above or below it
+    int moved = h->heap[h->count];
+    heap_place(h, pos, moved);
+    heap_sift_down(h, pos);
+    heap_sift_up(h, h->nodes[moved].heap_pos);
+  }
+
+  if (n->prev >= 0)
+    h->nodes[n->prev].next = n->next;
+  else
+    h->oldest = n->next;
+  if (n->next >= 0)
+    h->nodes[n->next].prev = n->prev;
+  else
+    h->newest = n->prev;
+
+  long long wait = now - n->request.enqueued_us;
+  sched_class_stats_t *cls = &h->classes[n->cls];
+  cls->dequeued++;
+  cls->wait_total_us += wait;
+  if (wait > cls->wait_max_us)
+    cls->wait_max_us = wait;
+
+  *request = n->request;
+  n->next = h->free_list;
+  h->free_list = node;
+  h->dequeued++;
+}
+
+static int heap_create(sched_t *s, int capacity, heap_key_fn key, heap_key_fn class_key,
+                       long long aging_rate, int max_wait_ms)
+{
+  heap_t *h = (heap_t *)calloc(1, sizeof(heap_t));
+  if (!h)
+    return -1;
+  h->nodes = (heap_node_t *)malloc(capacity * sizeof(heap_node_t));
+  h->heap = (int *)malloc(capacity * sizeof(int));
+  if (!h->nodes || !h->heap)
+  {
+    free(h->nodes);
+    free(h->heap);
+    free(h);
+    return -1;
+  }
+  for (int i = 0; i < capacity; i++)
+    h->nodes[i].next = i + 1 < capacity ? i + 1 : -1;
+  pthread_mutex_init(&h->mutex, NULL);
+  h->capacity = capacity;
+  h->oldest = h->newest = -1;
+  h->key = key;
+  h->class_key = class_key;
+  h->aging_rate = aging_rate;
+  h->max_wait_us = max_wait_ms * 1000LL;
+  s->impl = h;
+  return 0;
+}
+
+/**
+ * adds a request; with aging, the key grows with the time the request
+ * arrived, so a request that has waited longer competes with a smaller key.
+ * Every waiting request ages at the same rate, so the order of the heap never
+ * has to change as time passes
+ */
+static int heap_enqueue(sched_t *s, const request_t *request)
+{
+  heap_t *h = (heap_t *)s->impl;
+  long long key = h->key(request);
+  int rc = -1;
+
+  pthread_mutex_lock(&h->mutex);
+  if (h->count < h->capacity)
+  {
+    int node = h->free_list;
+    heap_node_t *n = &h->nodes[node];
+    h->free_list = n->next;
+
+    n->cls = heap_class(h->class_key(request));
+    n->key = h->aging_rate ? key * 1000 + h->aging_rate * (request->enqueued_us / 1000) : key;
+    n->seq = h->next_seq++;
+    n->request = *request;
+    n->prev = h->newest;
+    n->next = -1;
+    if (h->newest >= 0)
+      h->nodes[h->newest].next = node;
+    else
+      h->oldest = node;
+    h->newest = node;
+    h->classes[n->cls].enqueued++;
+
+    heap_place(h, h->count, node);
+    heap_sift_up(h, h->count++);
+    rc = 0;
+  }
+  pthread_mutex_unlock(&h->mutex);
+  return rc;
+}
+
+/**
+ * picks the node to serve next: the oldest request once it has waited the
+ * maximum time, the root of the heap otherwise
+ */
+static int heap_next(heap_t *h, long long now)
+{
+  if (h->max_wait_us > 0 && now - h->nodes[h->oldest].request.enqueued_us >= h->max_wait_us)
+    return h->oldest;
+  return h->heap[0];
+}
+
+static int heap_dequeue(sched_t *s, request_t *request)
+{
+  heap_t *h = (heap_t *)s->impl;
+  long long now = now_usec();
+  int rc = -1;
+
+  pthread_mutex_lock(&h->mutex);
+  if (h->count > 0)
+  {
+    heap_remove(h, heap_next(h, now), request, now);
+    rc = 0;
+  }
+  pthread_mutex_unlock(&h->mutex);
+  return rc;
+}
+
+static int heap_peek(sched_t *s, request_t *request)
+{
+  heap_t *h = (heap_t *)s->impl;
+  long long now = now_usec();
+  int rc = -1;
+
+  pthread_mutex_lock(&h->mutex);
+  if (h->count > 0)
+  {
+    *request = h->nodes[heap_next(h, now)].request;
+    rc = 0;
+  }
+  pthread_mutex_unlock(&h->mutex);
+  return rc;
+}
+
+static void heap_stats(sched_t *s, sched_stats_t *stats)
+{
+  heap_t *h = (heap_t *)s->impl;
+
+  pthread_mutex_lock(&h->mutex);
+  stats->enqueued = (long long)h->next_seq;
+  stats->dequeued = h->dequeued;
+  stats->depth = h->count;
+  for (int i = 0; i < SCHED_CLASSES; i++)
+    stats->classes[i] = h->classes[i];
+  pthread_mutex_unlock(&h->mutex);
+}
+
+// Shortest File First: the smallest estimated response goes first
+
+static long long sff_key(const request_t *request)
+{
+  return request->filesize;
+}
+
+static int sff_init(sched_t *s, int capacity)
+{
+  return heap_create(s, capacity, sff_key, sff_key, 0, 0);
+}
+
+const sched_ops_t sched_sff_ops = {
+    .name = "SFF",
+    .init = sff_init,
+    .enqueue = heap_enqueue,
+    .dequeue = heap_dequeue,
+    .peek = heap_peek,
+    .stats = heap_stats,
+};
+
+// SFF with aging: a request's estimated size shrinks by sched_aging_rate for
+// every second it waits, and a request that has waited sched_max_wait_ms goes
+// next whatever its size, so a stream of small requests cannot starve a large one
+
+static int sff_aging_init(sched_t *s, int capacity)
+{
+  return heap_create(s, capacity, sff_key, sff_key, sched_aging_rate, sched_max_wait_ms);
+}
+
+const sched_ops_t sched_sff_aging_ops = {
+    .name = "SFF-AGING",
+    .init = sff_aging_init,
+    .enqueue = heap_enqueue,
+    .dequeue = heap_dequeue,
+    .peek = heap_peek,
+    .stats = heap_stats,
+};
+
+// Shortest Job First: the request whose class has the shortest predicted
+// service time goes first
+
+static long long sjf_key(const request_t *request)
+{
+  return request->predicted_us;
+}
+
+static int sjf_init(sched_t *s, int capacity)
+{
+  return heap_create(s, capacity, sjf_key, sjf_key, 0, 0);
+}
+
+const sched_ops_t sched_sjf_ops = {
+    .name = "SJF",
+    .init = sjf_init,
+    .enqueue = heap_enqueue,
+    .dequeue = heap_dequeue,
+    .peek = heap_peek,
+    .stats = heap_stats,
+};
+
+// Earliest Deadline First: the request due soonest goes first; a request
+// without a deadline of its own is due sched_default_deadline_ms after it
+// arrived. Wait times are classed by the time the request was given
+
+static long long edf_key(const request_t *request)
+{
+  return request->deadline_us;
+}
+
+static long long edf_budget(const request_t *request)
+{
+  return request->deadline_us - request->enqueued_us;
+}
+
+static int edf_init(sched_t *s, int capacity)
+{
+  return heap_create(s, capacity, edf_key, edf_budget, 0, 0);
+}
+
+const sched_ops_t sched_edf_ops = {
+    .name = "EDF",
+    .init = edf_init,
+    .enqueue = heap_enqueue,
+    .dequeue = heap_dequeue,
+    .peek = heap_peek,
+    .stats = heap_stats,
+};
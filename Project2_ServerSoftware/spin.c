@@ -4,6 +4,7 @@
 #include <unistd.h>
 #include <sys/time.h>
 #include <assert.h>
+#include "cgi_worker.h"
 
 #define MAXBUF 8192
 
@@ -20,7 +21,8 @@ double get_seconds() {
     return (double) t.tv_sec + (double) t.tv_usec / 1e6;
 }
 
-int main(int argc, char *argv[]) {
+// Serves one request
+void spin(int argc, char *argv[]) {
     // Extract arguments
     double sleep_time = 0.0;
     char *buf;
@@ -66,6 +68,12 @@ int main(int argc, char *argv[]) {
     
     // Make sure the output is flushed
     fflush(stdout);
-    
+}
+
+int main(int argc, char *argv[]) {
+    // Runs once as a plain CGI program, or once per request as a pooled worker
+    while (cgi_worker_accept()) {
+        spin(argc, argv);
+    }
     return 0;
 }
\ No newline at end of file
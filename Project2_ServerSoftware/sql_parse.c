@@ -0,0 +1,204 @@
+#include <limits.h>
+#include "sqldb.h"
+
+/**
+ * decodes a URL-encoded query string into a SQL command
+ * '+' becomes a space and %XX escapes become the encoded character
+ *
+ * @param query_string the URL-encoded query string
+ * @param sql buffer receiving the decoded SQL command
+ * @param size size of the sql buffer in bytes
+ * @return length of the decoded command
+ */
+int sql_url_decode(const char *query_string, char *sql, int size)
+{
+    int i = 0, j = 0;
+
+    while (query_string[i] && j < size - 1)
+    {
+        if (query_string[i] == '+')
+        {
+            sql[j++] = ' ';
+        }
+        else if (query_string[i] == '%' && query_string[i + 1] && query_string[i + 2])
+        {
+            // Handle URL encoding (e.g., %20 = space)
+            char hex[3] = {query_string[i + 1], query_string[i + 2], 0};
+            sql[j++] = (char)strtol(hex, NULL, 16);
+            i += 2;
+        }
+        else
+        {
+            sql[j++] = query_string[i];
+        }
+        i++;
+    }
+    sql[j] = '\0';
+
+    return j;
+}
+
+/**
+ * case-insensitive of strstr that searches for needle in haystack
+ *
+ * @param haystack string to search in
+ * @param needle substring to search for
+ * @return pointer to the first occurrence of needle in haystack, or NULL if not found
+ */
+char *strncasestr(const char *haystack, const char *needle)
+{
+    size_t needle_len = strlen(needle);
+
+    while (*haystack)
+    {
+        if (strncasecmp(haystack, needle, needle_len) == 0)
+        {
+            return (char *)haystack;
+        }
+        haystack++;
+    }
+
+    return NULL;
+}
+
+/**
+ * parse SQL command string and determines its type
+ *
+ * @param sql The SQL command string to parse
+ * @param command_type Pointer to store the determined command type
+ * @return 0 on success, -1 if command type is unknown
+ */
+int parse_sql_command(char *sql, int *command_type)
+{
+    if (strncasecmp(sql, "CREATE", 6) == 0)
+    {
+        *command_type = CMD_CREATE;
+    }
+    else if (strncasecmp(sql, "INSERT", 6) == 0)
+    {
+        *command_type = CMD_INSERT;
+    }
+    else if (strncasecmp(sql, "UPDATE", 6) == 0)
+    {
+        *command_type = CMD_UPDATE;
+    }
+    else if (strncasecmp(sql, "SELECT", 6) == 0)
+    {
+        *command_type = CMD_SELECT;
+    }
+    else if (strncasecmp(sql, "DELETE", 6) == 0)
+    {
+        *command_type = CMD_DELETE;
+    }
+    else
+    {
+        return -1; // base case
+    }
+
+    return 0;
+}
+
+/**
+ * finds the type of a command and the name of the table it works on
+ * the name follows INTO for INSERT, the command word for UPDATE and FROM for
+ * SELECT and DELETE; only letters, digits and '_' are taken, so the name can
+ * be used to build a file name. Nothing is executed and no lock is taken
+ *
+ * @param sql the SQL command, leading whitespace allowed
+ * @param command_type receives the type as by parse_sql_command()
+ * @param table_name buffer of 32 bytes receiving the name
+ * @return 0 on success, -1 if the command is unknown, is a CREATE or names no table
+ */
+int sql_command_table(const char *sql, int *command_type, char *table_name)
+{
+    const char *p;
+
+    while (*sql && isspace((unsigned char)*sql))
+        sql++;
+    if (parse_sql_command((char *)sql, command_type) != 0 || *command_type == CMD_CREATE)
+        return -1;
+
+    if (*command_type == CMD_INSERT)
+        p = strncasestr(sql, "INTO");
+    else if (*command_type == CMD_UPDATE)
+        p = sql;
+    else
+        p = strncasestr(sql, "FROM");
+    if (p == NULL)
+        return -1;
+
+    p += *command_type == CMD_UPDATE ? 6 : 4;
+    while (*p && isspace((unsigned char)*p))
+        p++;
+
+    int i = 0;
+    while ((isalnum((unsigned char)*p) || *p == '_') && i < 31)
+        table_name[i++] = *p++;
+    table_name[i] = '\0';
+
+    return i > 0 ? 0 : -1;
+}
+
+/**
+ * guesses the percentage of rows a WHERE clause keeps, from its operator
+ * alone since the catalog keeps no column statistics: an equality keeps few
+ * rows, a range about a third and an inequality nearly all
+ */
+static int sql_where_selectivity(const char *sql)
+{
+    const char *p = strncasestr(sql, "WHERE");
+    if (p == NULL)
+        return 100;
+
+    for (p += 5; *p; p++)
+    {
+        if (*p == '!' || (p[0] == '<' && p[1] == '>'))
+            return SQL_SELECTIVITY_NOT_EQUAL;
+        if (*p == '<' || *p == '>')
+            return SQL_SELECTIVITY_RANGE;
+        if (*p == '=')
+            return SQL_SELECTIVITY_EQUAL;
+    }
+    return 100;
+}
+
+/**
+ * estimates the cost of a SQL command in blocks, without running it or taking
+ * the engine's lock, so that the scheduler can rank queries
+ * every command on a table walks its whole block chain, so the table file's
+ * size sets the base cost; SELECT adds the blocks of output it is expected
+ * to produce, UPDATE and DELETE the blocks they are expected to rewrite, and
+ * INSERT the one block it appends to. CREATE, unknown commands and missing
+ * tables cost one block: they fail or finish without a scan
+ *
+ * @param sql the decoded SQL command
+ * @return estimated number of blocks read and written, at least 1 and at most
+ *         INT_MAX
+ */
+int sql_estimate_cost(const char *sql)
+{
+    int command_type;
+    char table_name[32];
+    char data_filename[64];
+    struct stat st;
+
+    if (sql_command_table(sql, &command_type, table_name) != 0)
+        return 1;
+
+    snprintf(data_filename, sizeof(data_filename), "%s.dat", table_name);
+    if (stat(data_filename, &st) < 0)
+        return 1;
+
+    long long blocks = st.st_size / BLOCK_SIZE;
+    if (blocks < 1)
+        blocks = 1;
+
+    // the blocks touched beyond the scan; a selective query on a small table
+    // rounds down to the scan alone
+    if (command_type == CMD_INSERT)
+        blocks += 1;
+    else
+        blocks += blocks * sql_where_selectivity(sql) / 100;
+
+    return blocks > INT_MAX ? INT_MAX : (int)blocks;
+}
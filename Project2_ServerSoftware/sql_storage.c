@@ -0,0 +1,207 @@
+#include "sqldb.h"
+
+/**
+ * creates a new block in the database file.
+ *
+ * @param fd file descriptor of the database file
+ * @return block number of the newly created block, or -1 on error
+ */
+int create_new_block(int fd)
+{
+    struct stat st;
+
+    if (fstat(fd, &st) < 0)
+    {
+        return -1;
+    }
+
+    int block_num = st.st_size / BLOCK_SIZE;
+
+    char block[BLOCK_SIZE];
+    memset(block, '.', BLOCK_SIZE);
+    strncpy(block + BLOCK_SIZE - 4, END_MARKER, 4);
+
+    if (write_block(fd, block_num, block) < 0)
+    {
+        return -1;
+    }
+
+    return block_num;
+}
+
+/**
+ * reads a block from the database file.
+ * uses pread() so each block costs one system call and the file offset is
+ * left alone, which also lets threads share the descriptor
+ *
+ * @param fd file descriptor of the database file
+ * @param block_num block number to read
+ * @param block buffer to store the read block data
+ * @return 0 on success, -1 on error
+ */
+int read_block(int fd, int block_num, char *block)
+{
+    off_t offset = (off_t)block_num * BLOCK_SIZE;
+
+    if (pread(fd, block, BLOCK_SIZE, offset) != BLOCK_SIZE)
+    {
+        return -1;
+    }
+
+    return 0;
+}
+
+/**
+ * writes a block to the database file with a single pwrite().
+ *
+ * @param fd file descriptor of the database file
+ * @param block_num block number to write to
+ * @param block block data to write
+ * @return 0 on success, -1 on error
+ */
+int write_block(int fd, int block_num, char *block)
+{
+    off_t offset = (off_t)block_num * BLOCK_SIZE;
+
+    if (pwrite(fd, block, BLOCK_SIZE, offset) != BLOCK_SIZE)
+    {
+        return -1;
+    }
+
+    return 0;
+}
+
+/**
+ * finds a free block in the database file.
+ *
+ * @param fd file descriptor of the database file
+ * @return block number of a free block, or -1 if no free blocks found
+ */
+int find_free_block(int fd)
+{
+    struct stat st;
+
+    if (fstat(fd, &st) < 0)
+    {
+        return -1;
+    }
+
+    int num_blocks = st.st_size / BLOCK_SIZE;
+    char block[BLOCK_SIZE];
+
+    for (int i = 0; i < num_blocks; i++)
+    {
+        if (read_block(fd, i, block) < 0)
+        {
+            continue;
+        }
+
+        // check if block is empty
+        int empty = 1;
+        for (int j = 0; j < BLOCK_SIZE - 4; j++)
+        {
+            if (block[j] != '.')
+            {
+                empty = 0;
+                break;
+            }
+        }
+
+        if (empty)
+        {
+            return i;
+        }
+    }
+
+    return -1;
+}
+
+/**
+ * finds the schema for a specified table.
+ * CREATE TABLE stores each schema in its own block, so every block of
+ * schema.dat is examined; strtok_r keeps this safe to call from several
+ * server threads at once
+ *
+ * @param table_name name of the table to find
+ * @param schema pointer to store the found schema
+ * @return 0 on success, -1 if table not found
+ */
+int find_table_schema(char *table_name, TableSchema *schema)
+{
+    int schema_fd = open("schema.dat", O_RDONLY);
+    if (schema_fd < 0)
+    {
+        return -1; // schema file DNE, so table DNE
+    }
+
+    char block[BLOCK_SIZE + 1];
+    int block_num = 0;
+
+    while (read_block(schema_fd, block_num++, block) == 0)
+    {
+        // schema text ends before the next block pointer
+        block[BLOCK_SIZE - 4] = '\0';
+
+        // format: tablename|col1:type1,col2:type2,...;
+        char *saveptr;
+        char *table_str = strtok_r(block, "|", &saveptr);
+        if (table_str == NULL || strcmp(table_str, table_name) != 0)
+        {
+            continue;
+        }
+
+        strcpy(schema->name, table_name);
+
+        char *columns_str = strtok_r(NULL, ";", &saveptr);
+        if (columns_str == NULL)
+        {
+            close(schema_fd);
+            return -1;
+        }
+
+        char *columns[MAX_COLS];
+        int num_columns = 0;
+
+        char *column = strtok_r(columns_str, ",", &saveptr);
+        while (column != NULL && num_columns < MAX_COLS)
+        {
+            columns[num_columns++] = column;
+            column = strtok_r(NULL, ",", &saveptr);
+        }
+
+        schema->num_columns = num_columns;
+
+        for (int i = 0; i < num_columns; i++)
+        {
+            char *name = strtok_r(columns[i], ":", &saveptr);
+            char *type = strtok_r(NULL, "", &saveptr);
+
+            if (name != NULL && type != NULL)
+            {
+                strcpy(schema->columns[i].name, name);
+
+                if (strncmp(type, "char(", 5) == 0)
+                {
+                    schema->columns[i].type = TYPE_CHAR;
+                    schema->columns[i].size = atoi(type + 5);
+                }
+                else if (strcmp(type, "smallint") == 0)
+                {
+                    schema->columns[i].type = TYPE_SMALLINT;
+                    schema->columns[i].size = 4;
+                }
+                else if (strcmp(type, "int") == 0)
+                {
+                    schema->columns[i].type = TYPE_INTEGER;
+                    schema->columns[i].size = 8;
+                }
+            }
+        }
+
+        close(schema_fd);
+        return 0;
+    }
+
+    close(schema_fd);
+    return -1;
+}
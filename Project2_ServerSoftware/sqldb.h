@@ -0,0 +1,111 @@
+#ifndef __SQLDB_H__
+#define __SQLDB_H__
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <ctype.h>
+#include <stdarg.h>
+
+#define BLOCK_SIZE 256
+#define MAX_TABLES 20
+#define MAX_COLS 10
+#define MAX_QUERY_LEN 1024
+#define END_MARKER "XXXX"
+
+// data types
+#define TYPE_CHAR 1
+#define TYPE_SMALLINT 2
+#define TYPE_INTEGER 3
+
+// SQL commands
+#define CMD_CREATE 1
+#define CMD_INSERT 2
+#define CMD_UPDATE 3
+#define CMD_SELECT 4
+#define CMD_DELETE 5
+
+// SQL comparison operators
+#define OP_EQUAL 1
+#define OP_NOT_EQUAL 2
+#define OP_GREATER 3
+#define OP_LESS 4
+
+// share of rows a WHERE clause is assumed to keep, in percent, by operator
+#define SQL_SELECTIVITY_EQUAL 10
+#define SQL_SELECTIVITY_RANGE 33
+#define SQL_SELECTIVITY_NOT_EQUAL 90
+
+// structure to store column information
+typedef struct
+{
+    char name[32];
+    int type;
+    int size;
+} Column;
+
+// structure to store table schema
+typedef struct
+{
+    char name[32];
+    int num_columns;
+    Column columns[MAX_COLS];
+} TableSchema;
+
+// structure for WHERE clause condition
+typedef struct
+{
+    char column_name[32];
+    int op;
+    char value[256];
+} Condition;
+
+// growable text buffer for building responses
+typedef struct
+{
+    char *data;
+    int len;
+    int cap;
+} SqlBuffer;
+
+// result of one SQL command: what the CGI program prints or the server sends
+typedef struct
+{
+    char content_type[32];
+    SqlBuffer body;
+    int error; // set once an error response has been produced
+} SqlOutput;
+
+// parser (sql_parse.c)
+int sql_url_decode(const char *query_string, char *sql, int size);
+int parse_sql_command(char *sql, int *command_type);
+char *strncasestr(const char *haystack, const char *needle);
+int sql_command_table(const char *sql, int *command_type, char *table_name);
+int sql_estimate_cost(const char *sql);
+
+// executor (sql_exec.c)
+int sql_execute(char *sql, SqlOutput *out);
+int execute_create(char *sql, SqlOutput *out);
+int execute_insert(char *sql, SqlOutput *out);
+int execute_update(char *sql, SqlOutput *out);
+int execute_select(char *sql, SqlOutput *out);
+int execute_delete(char *sql, SqlOutput *out);
+void send_http_response(SqlOutput *out, char *content_type, char *body);
+void send_error_response(SqlOutput *out, char *error_msg);
+void sql_buffer_printf(SqlBuffer *buf, const char *fmt, ...);
+void sql_output_init(SqlOutput *out);
+void sql_output_free(SqlOutput *out);
+
+// storage (sql_storage.c)
+int find_table_schema(char *table_name, TableSchema *schema);
+int create_new_block(int fd);
+int read_block(int fd, int block_num, char *block);
+int write_block(int fd, int block_num, char *block);
+int find_free_block(int fd);
+
+#endif // __SQLDB_H__
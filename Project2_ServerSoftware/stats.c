@@ -0,0 +1,398 @@
+#include <pthread.h>
+#include <stdarg.h>
+#include "stats.h"
+#include "access_log.h"
+#include "io_helper.h"
+#include "mpmc.h"
+
+// every thread counts into a shard of its own, which only it writes, so
+// counting is a plain load and store with no lock and no shared cache line;
+// the shards are only summed when /__stats is requested
+
+typedef struct
+{
+  _Atomic long long buckets[STATS_BUCKETS];
+  _Atomic long long count;
+  _Atomic long long sum_us;
+} stats_hist_t;
+
+typedef struct stats_shard
+{
+  _Atomic long long counters[STATS_COUNTERS];
+  stats_hist_t wait[STATS_KINDS];    // time in the request queue
+  stats_hist_t service[STATS_KINDS]; // time a worker spent on the request
+  _Atomic int owned;                 // a live thread counts into the shard
+  struct stats_shard *next;          // all shards, never removed
+} stats_shard_t;
+
+static const char *stats_kinds[STATS_KINDS] = {
+    "static", "dynamic", "sql_select", "sql_insert", "sql_update", "sql_delete", "sql_create", "sql_other"};
+
+static _Atomic(stats_shard_t *) shards;
+static pthread_key_t shard_key;
+static __thread stats_shard_t *my_shard;
+static stats_lanes_fn lane_source;
+static long long start_us;
+
+// the previous collection, for the accept rate
+static pthread_mutex_t rate_mutex = PTHREAD_MUTEX_INITIALIZER;
+static long long rate_accepted, rate_us;
+
+/**
+ * hands the shard of an exiting thread to the next thread that needs one;
+ * its counts stay in the totals
+ */
+static void stats_release(void *arg)
+{
+  stats_shard_t *shard = (stats_shard_t *)arg;
+  atomic_store_explicit(&shard->owned, 0, memory_order_release);
+}
+
+/**
+ * finds the calling thread's shard, claiming an unowned one or adding a new
+ * one the first time the thread counts something
+ *
+ * @return the shard, or NULL if memory ran out
+ */
+static stats_shard_t *stats_shard(void)
+{
+  if (my_shard)
+    return my_shard;
+
+  stats_shard_t *shard;
+  for (shard = atomic_load(&shards); shard; shard = shard->next)
+  {
+    int expected = 0;
+    if (atomic_compare_exchange_strong(&shard->owned, &expected, 1))
+      break;
+  }
+  if (!shard)
+  {
+    size_t size = (sizeof(stats_shard_t) + CACHE_LINE - 1) / CACHE_LINE * CACHE_LINE;
+    shard = (stats_shard_t *)aligned_alloc(CACHE_LINE, size);
+    if (!shard)
+      return NULL;
+    memset(shard, 0, sizeof(*shard));
+    atomic_init(&shard->owned, 1);
+    shard->next = atomic_load(&shards);
+    while (!atomic_compare_exchange_weak(&shards, &shard->next, shard))
+      ;
+  }
+  my_shard = shard;
+  pthread_setspecific(shard_key, shard);
+  return shard;
+}
+
+/**
+ * adds to a counter only the owning thread writes, without a locked instruction
+ */
+static void stats_add(_Atomic long long *counter, long long n)
+{
+  atomic_store_explicit(counter, atomic_load_explicit(counter, memory_order_relaxed) + n, memory_order_relaxed);
+}
+
+static void stats_hist_add(stats_hist_t *hist, long long usec)
+{
+  int bucket = 0;
+  if (usec > 1)
+    bucket = 63 - __builtin_clzll((unsigned long long)usec);
+  if (bucket >= STATS_BUCKETS)
+    bucket = STATS_BUCKETS - 1;
+  stats_add(&hist->buckets[bucket], 1);
+  stats_add(&hist->count, 1);
+  stats_add(&hist->sum_us, usec > 0 ? usec : 0);
+}
+
+/**
+ * starts the clock for the accept rate and the uptime
+ *
+ * @param lanes reports the server's request queues and workers
+ */
+void stats_init(stats_lanes_fn lanes)
+{
+  pthread_key_create(&shard_key, stats_release);
+  lane_source = lanes;
+  start_us = rate_us = now_usec();
+}
+
+void stats_count(int counter, long long n)
+{
+  stats_shard_t *shard = stats_shard();
+  if (shard)
+    stats_add(&shard->counters[counter], n);
+}
+
+/**
+ * adds a request to the latency histograms of its kind
+ *
+ * @param kind STATS_STATIC, STATS_DYNAMIC or one of the SQL statement kinds
+ * @param wait_us time the request spent in the queue
+ * @param service_us time a worker spent on the request
+ */
+void stats_record(int kind, long long wait_us, long long service_us)
+{
+  stats_shard_t *shard = stats_shard();
+  if (!shard)
+    return;
+  stats_hist_add(&shard->wait[kind], wait_us);
+  stats_hist_add(&shard->service[kind], service_us);
+}
+
+// a snapshot of every shard summed, taken while other threads keep counting
+typedef struct
+{
+  long long counters[STATS_COUNTERS];
+  long long wait[STATS_KINDS][STATS_BUCKETS + 2]; // buckets, then count and sum
+  long long service[STATS_KINDS][STATS_BUCKETS + 2];
+} stats_totals_t;
+
+static void stats_hist_sum(long long *out, stats_hist_t *hist)
+{
+  for (int i = 0; i < STATS_BUCKETS; i++)
+    out[i] += atomic_load_explicit(&hist->buckets[i], memory_order_relaxed);
+  out[STATS_BUCKETS] += atomic_load_explicit(&hist->count, memory_order_relaxed);
+  out[STATS_BUCKETS + 1] += atomic_load_explicit(&hist->sum_us, memory_order_relaxed);
+}
+
+static void stats_sum(stats_totals_t *totals)
+{
+  memset(totals, 0, sizeof(*totals));
+  for (stats_shard_t *shard = atomic_load(&shards); shard; shard = shard->next)
+  {
+    for (int i = 0; i < STATS_COUNTERS; i++)
+      totals->counters[i] += atomic_load_explicit(&shard->counters[i], memory_order_relaxed);
+    for (int k = 0; k < STATS_KINDS; k++)
+    {
+      stats_hist_sum(totals->wait[k], &shard->wait[k]);
+      stats_hist_sum(totals->service[k], &shard->service[k]);
+    }
+  }
+}
+
+// a growing text buffer for the response body
+typedef struct
+{
+  char *data;
+  int len;
+  int size;
+} stats_buf_t;
+
+static void stats_printf(stats_buf_t *buf, const char *fmt, ...)
+{
+  va_list args;
+  while (buf->data)
+  {
+    va_start(args, fmt);
+    int n = vsnprintf(buf->data + buf->len, buf->size - buf->len, fmt, args);
+    va_end(args);
+    if (buf->len + n < buf->size)
+    {
+      buf->len += n;
+      return;
+    }
+    char *data = (char *)realloc(buf->data, buf->size * 2 + n);
+    if (!data)
+    {
+      free(buf->data);
+      buf->data = NULL;
+      return;
+    }
+    buf->data = data;
+    buf->size = buf->size * 2 + n;
+  }
+}
+
+static void stats_json_hist(stats_buf_t *buf, const char *name, long long hist[][STATS_BUCKETS + 2])
+{
+  stats_printf(buf, "\"%s\":{", name);
+  for (int k = 0; k < STATS_KINDS; k++)
+  {
+    stats_printf(buf, "%s\"%s\":{\"count\":%lld,\"sum_us\":%lld,\"buckets\":[",
+                 k ? "," : "", stats_kinds[k], hist[k][STATS_BUCKETS], hist[k][STATS_BUCKETS + 1]);
+    for (int i = 0; i < STATS_BUCKETS; i++)
+      stats_printf(buf, "%s%lld", i ? "," : "", hist[k][i]);
+    stats_printf(buf, "]}");
+  }
+  stats_printf(buf, "}");
+}
+
+/**
+ * writes a histogram the Prometheus way: cumulative buckets in seconds
+ */
+static void stats_prometheus_hist(stats_buf_t *buf, const char *name, const char *help,
+                                  long long hist[][STATS_BUCKETS + 2])
+{
+  stats_printf(buf, "# HELP %s %s\n# TYPE %s histogram\n", name, help, name);
+  for (int k = 0; k < STATS_KINDS; k++)
+  {
+    long long total = 0;
+    for (int i = 0; i < STATS_BUCKETS - 1; i++)
+    {
+      total += hist[k][i];
+      stats_printf(buf, "%s_bucket{kind=\"%s\",le=\"%g\"} %lld\n", name, stats_kinds[k],
+                   (double)(1LL << (i + 1)) / 1e6, total);
+    }
+    stats_printf(buf, "%s_bucket{kind=\"%s\",le=\"+Inf\"} %lld\n", name, stats_kinds[k], hist[k][STATS_BUCKETS]);
+    stats_printf(buf, "%s_sum{kind=\"%s\"} %g\n", name, stats_kinds[k], hist[k][STATS_BUCKETS + 1] / 1e6);
+    stats_printf(buf, "%s_count{kind=\"%s\"} %lld\n", name, stats_kinds[k], hist[k][STATS_BUCKETS]);
+  }
+}
+
+/**
+ * collects every counter, gauge and histogram
+ *
+ * @param prometheus nonzero for the Prometheus text format, zero for JSON
+ * @param len receives the length of the text
+ * @return the text, to be freed by the caller, or NULL if memory ran out
+ */
+char *stats_render(int prometheus, int *len)
+{
+  stats_totals_t *totals = (stats_totals_t *)malloc(sizeof(stats_totals_t));
+  if (!totals)
+    return NULL;
+  stats_sum(totals);
+  long long *counters = totals->counters;
+
+  int num_lanes = lane_source ? lane_source(NULL, 0) : 0;
+  stats_lane_t *lanes = (stats_lane_t *)calloc(num_lanes + 1, sizeof(stats_lane_t));
+  if (!lanes)
+  {
+    free(totals);
+    return NULL;
+  }
+  if (num_lanes > 0)
+    num_lanes = lane_source(lanes, num_lanes);
+  int buffer_count = 0;
+  for (int i = 0; i < num_lanes; i++)
+    buffer_count += lanes[i].depth;
+
+  access_log_stats_t log;
+  access_log_stats(&log);
+
+  // the accept rate covers the time since the previous collection
+  long long now = now_usec();
+  pthread_mutex_lock(&rate_mutex);
+  double elapsed = (now - rate_us) / 1e6;
+  double accept_rate = elapsed > 0 ? (counters[STATS_ACCEPTED] - rate_accepted) / elapsed : 0;
+  rate_accepted = counters[STATS_ACCEPTED];
+  rate_us = now;
+  pthread_mutex_unlock(&rate_mutex);
+  double uptime = (now - start_us) / 1e6;
+
+  stats_buf_t buf = {(char *)malloc(16384), 0, 16384};
+  if (prometheus)
+  {
+    stats_printf(&buf, "# HELP wserver_uptime_seconds Time since the server started.\n"
+                       "# TYPE wserver_uptime_seconds gauge\nwserver_uptime_seconds %.3f\n",
+                 uptime);
+    stats_printf(&buf, "# HELP wserver_buffer_count Requests waiting in the request buffers.\n"
+                       "# TYPE wserver_buffer_count gauge\nwserver_buffer_count %d\n",
+                 buffer_count);
+    stats_printf(&buf, "# HELP wserver_accepted_total Connections accepted.\n"
+                       "# TYPE wserver_accepted_total counter\nwserver_accepted_total %lld\n",
+                 counters[STATS_ACCEPTED]);
+    stats_printf(&buf, "# HELP wserver_accept_rate Connections accepted per second since the previous collection.\n"
+                       "# TYPE wserver_accept_rate gauge\nwserver_accept_rate %.3f\n",
+                 accept_rate);
+    stats_printf(&buf, "# HELP wserver_requests_total Requests served by a worker.\n"
+                       "# TYPE wserver_requests_total counter\nwserver_requests_total %lld\n",
+                 counters[STATS_REQUESTS]);
+    stats_printf(&buf, "# HELP wserver_shed_total Requests answered with 503 because of overload.\n"
+                       "# TYPE wserver_shed_total counter\nwserver_shed_total %lld\n",
+                 counters[STATS_SHED]);
+    stats_printf(&buf, "# HELP wserver_expired_total Requests whose deadline passed while queued.\n"
+                       "# TYPE wserver_expired_total counter\nwserver_expired_total %lld\n",
+                 counters[STATS_EXPIRED]);
+    stats_printf(&buf, "# HELP wserver_cgi_spawns_total CGI processes started.\n"
+                       "# TYPE wserver_cgi_spawns_total counter\nwserver_cgi_spawns_total %lld\n",
+                 counters[STATS_CGI_SPAWNS]);
+    stats_printf(&buf, "# HELP wserver_access_log_lines_total Access log lines written.\n"
+                       "# TYPE wserver_access_log_lines_total counter\nwserver_access_log_lines_total %lld\n"
+                       "# HELP wserver_access_log_dropped_total Access log entries lost to full rings.\n"
+                       "# TYPE wserver_access_log_dropped_total counter\nwserver_access_log_dropped_total %lld\n",
+                 log.logged, log.dropped);
+
+    stats_printf(&buf, "# HELP wserver_queue_depth Requests waiting in a lane.\n# TYPE wserver_queue_depth gauge\n");
+    for (int i = 0; i < num_lanes; i++)
+      stats_printf(&buf, "wserver_queue_depth{lane=\"%s\",policy=\"%s\"} %d\n", lanes[i].name, lanes[i].policy, lanes[i].depth);
+    stats_printf(&buf, "# HELP wserver_sched_enqueued_total Requests added to a lane's queue.\n# TYPE wserver_sched_enqueued_total counter\n");
+    for (int i = 0; i < num_lanes; i++)
+      stats_printf(&buf, "wserver_sched_enqueued_total{lane=\"%s\",policy=\"%s\"} %lld\n", lanes[i].name, lanes[i].policy, lanes[i].enqueued);
+    stats_printf(&buf, "# HELP wserver_sched_dequeued_total Requests taken from a lane's queue.\n# TYPE wserver_sched_dequeued_total counter\n");
+    for (int i = 0; i < num_lanes; i++)
+      stats_printf(&buf, "wserver_sched_dequeued_total{lane=\"%s\",policy=\"%s\"} %lld\n", lanes[i].name, lanes[i].policy, lanes[i].dequeued);
+    stats_printf(&buf, "# HELP wserver_codel_shed_total Requests CoDel shed from a lane.\n# TYPE wserver_codel_shed_total counter\n");
+    for (int i = 0; i < num_lanes; i++)
+      stats_printf(&buf, "wserver_codel_shed_total{lane=\"%s\"} %lld\n", lanes[i].name, lanes[i].shed);
+    stats_printf(&buf, "# HELP wserver_sched_class_dequeued_total Requests of a wait time class taken from a lane's queue.\n"
+                       "# TYPE wserver_sched_class_dequeued_total counter\n");
+    for (int i = 0; i < num_lanes; i++)
+      for (int c = 0; c < SCHED_CLASSES; c++)
+        stats_printf(&buf, "wserver_sched_class_dequeued_total{lane=\"%s\",class=\"%d\"} %lld\n", lanes[i].name, c, lanes[i].classes[c].dequeued);
+    stats_printf(&buf, "# HELP wserver_sched_class_wait_seconds_total Time the requests of a wait time class spent queued.\n"
+                       "# TYPE wserver_sched_class_wait_seconds_total counter\n");
+    for (int i = 0; i < num_lanes; i++)
+      for (int c = 0; c < SCHED_CLASSES; c++)
+        stats_printf(&buf, "wserver_sched_class_wait_seconds_total{lane=\"%s\",class=\"%d\"} %g\n", lanes[i].name, c, lanes[i].classes[c].wait_total_us / 1e6);
+    stats_printf(&buf, "# HELP wserver_sched_class_wait_max_seconds Longest time a request of a wait time class spent queued.\n"
+                       "# TYPE wserver_sched_class_wait_max_seconds gauge\n");
+    for (int i = 0; i < num_lanes; i++)
+      for (int c = 0; c < SCHED_CLASSES; c++)
+        stats_printf(&buf, "wserver_sched_class_wait_max_seconds{lane=\"%s\",class=\"%d\"} %g\n", lanes[i].name, c, lanes[i].classes[c].wait_max_us / 1e6);
+    stats_printf(&buf, "# HELP wserver_workers Worker threads of a lane.\n# TYPE wserver_workers gauge\n");
+    for (int i = 0; i < num_lanes; i++)
+    {
+      stats_printf(&buf, "wserver_workers{lane=\"%s\",state=\"busy\"} %d\n", lanes[i].name, lanes[i].busy);
+      stats_printf(&buf, "wserver_workers{lane=\"%s\",state=\"idle\"} %d\n", lanes[i].name, lanes[i].workers - lanes[i].busy);
+    }
+    stats_printf(&buf, "# HELP wserver_pool_peak_workers Most worker threads a lane has had at once.\n# TYPE wserver_pool_peak_workers gauge\n");
+    for (int i = 0; i < num_lanes; i++)
+      stats_printf(&buf, "wserver_pool_peak_workers{lane=\"%s\"} %d\n", lanes[i].name, lanes[i].peak);
+    stats_printf(&buf, "# HELP wserver_pool_grown_total Workers the elastic pool of a lane started.\n# TYPE wserver_pool_grown_total counter\n");
+    for (int i = 0; i < num_lanes; i++)
+      stats_printf(&buf, "wserver_pool_grown_total{lane=\"%s\"} %lld\n", lanes[i].name, lanes[i].grown);
+    stats_printf(&buf, "# HELP wserver_pool_shrunk_total Workers the elastic pool of a lane retired.\n# TYPE wserver_pool_shrunk_total counter\n");
+    for (int i = 0; i < num_lanes; i++)
+      stats_printf(&buf, "wserver_pool_shrunk_total{lane=\"%s\"} %lld\n", lanes[i].name, lanes[i].shrunk);
+
+    stats_prometheus_hist(&buf, "wserver_queue_wait_seconds", "Time requests spent in the request buffer.", totals->wait);
+    stats_prometheus_hist(&buf, "wserver_service_seconds", "Time workers spent serving requests.", totals->service);
+  }
+  else
+  {
+    stats_printf(&buf, "{\"uptime_s\":%.3f,\"buffer_count\":%d,\"accepted\":%lld,\"accept_rate\":%.3f,"
+                       "\"requests\":%lld,\"shed\":%lld,\"expired\":%lld,\"cgi_spawns\":%lld,"
+                       "\"access_log\":{\"logged\":%lld,\"dropped\":%lld,\"sample\":%d},\"lanes\":[",
+                 uptime, buffer_count, counters[STATS_ACCEPTED], accept_rate, counters[STATS_REQUESTS],
+                 counters[STATS_SHED], counters[STATS_EXPIRED], counters[STATS_CGI_SPAWNS],
+                 log.logged, log.dropped, log.sample);
+    for (int i = 0; i < num_lanes; i++)
+    {
+      stats_printf(&buf, "%s{\"name\":\"%s\",\"policy\":\"%s\",\"depth\":%d,\"enqueued\":%lld,\"dequeued\":%lld,"
+                         "\"shed\":%lld,\"workers\":%d,\"busy\":%d,\"idle\":%d,\"peak\":%d,\"grown\":%lld,\"shrunk\":%lld,\"classes\":[",
+                   i ? "," : "", lanes[i].name, lanes[i].policy, lanes[i].depth, lanes[i].enqueued,
+                   lanes[i].dequeued, lanes[i].shed, lanes[i].workers, lanes[i].busy, lanes[i].workers - lanes[i].busy,
+                   lanes[i].peak, lanes[i].grown, lanes[i].shrunk);
+      for (int c = 0; c < SCHED_CLASSES; c++)
+      {
+        sched_class_stats_t *cls = &lanes[i].classes[c];
+        stats_printf(&buf, "%s{\"enqueued\":%lld,\"dequeued\":%lld,\"wait_total_us\":%lld,\"wait_max_us\":%lld}",
+                     c ? "," : "", cls->enqueued, cls->dequeued, cls->wait_total_us, cls->wait_max_us);
+      }
+      stats_printf(&buf, "]}");
+    }
+    stats_printf(&buf, "],\"bucket_bounds_us\":[");
+    for (int i = 0; i < STATS_BUCKETS - 1; i++)
+      stats_printf(&buf, "%s%lld", i ? "," : "", 1LL << (i + 1));
+    stats_printf(&buf, "],");
+    stats_json_hist(&buf, "queue_us", totals->wait);
+    stats_printf(&buf, ",");
+    stats_json_hist(&buf, "service_us", totals->service);
+    stats_printf(&buf, "}\n");
+  }
+
+  free(lanes);
+  free(totals);
+  *len = buf.len;
+  return buf.data;
+}
@@ -0,0 +1,52 @@
+#ifndef __STATS_H__
+#define __STATS_H__
+
+#include "sched.h"
+
+// counters (stats_count)
+#define STATS_ACCEPTED 0   // connections accepted
+#define STATS_REQUESTS 1   // requests served by a worker
+#define STATS_SHED 2       // requests answered with 503 because of overload
+#define STATS_EXPIRED 3    // requests whose X-Deadline-Ms passed in the queue
+#define STATS_CGI_SPAWNS 4 // CGI processes started, per request or for the pool
+#define STATS_COUNTERS 5
+
+// kinds of request, each with its own latency histograms (stats_record)
+#define STATS_STATIC 0
+#define STATS_DYNAMIC 1
+#define STATS_SQL_SELECT 2
+#define STATS_SQL_INSERT 3
+#define STATS_SQL_UPDATE 4
+#define STATS_SQL_DELETE 5
+#define STATS_SQL_CREATE 6
+#define STATS_SQL_OTHER 7
+#define STATS_KINDS 8
+
+#define STATS_BUCKETS 24 // bucket i counts values below 2^(i+1) usec; the last one also every larger value
+
+// a request queue and its workers, as reported by the server
+typedef struct
+{
+  char name[32];
+  const char *policy;
+  int depth;          // requests waiting now
+  long long enqueued; // since startup
+  long long dequeued;
+  long long shed;     // by CoDel
+  sched_class_stats_t classes[SCHED_CLASSES]; // queue wait per class, zero for policies without classes
+  int workers;
+  int busy;
+  int peak;         // most workers at once
+  long long grown;  // workers the elastic pool started
+  long long shrunk; // workers the elastic pool retired
+} stats_lane_t;
+
+// fills in at most max lanes and returns how many there are
+typedef int (*stats_lanes_fn)(stats_lane_t *lanes, int max);
+
+void stats_init(stats_lanes_fn lanes);
+void stats_count(int counter, long long n);
+void stats_record(int kind, long long wait_us, long long service_us);
+char *stats_render(int prometheus, int *len);
+
+#endif // __STATS_H__
@@ -0,0 +1,110 @@
+#!/bin/bash
+# test_access_log.sh - Test script for the asynchronous access log (-l, -L, SIGUSR2 and log_sample)
+SERVER_URL="http://localhost:8003"
+PORT=8003
+LOG_FILE="access_log_test.log"
+
+echo "===== Testing Access Log ====="
+
+# Stop any running server
+pkill -f "wserver -p $PORT" 2>/dev/null
+sleep 1
+rm -f $LOG_FILE
+
+echo "Starting server with -l $LOG_FILE (4 threads, 16 buffers)..."
+./wserver -p $PORT -t 4 -b 16 -l $LOG_FILE > /dev/null 2>&1 &
+SERVER_PID=$!
+sleep 1
+
+# Test 1: every request becomes one JSON line with its status and timings
+echo -e "\nTest 1: 50 concurrent requests are logged"
+start_time=$(date +%s.%N)
+for i in $(seq 1 50); do
+    curl -s -o /dev/null "$SERVER_URL/index.html?n=$i" &
+done
+wait $(jobs -p | grep -v "^$SERVER_PID$")
+end_time=$(date +%s.%N)
+total_time=$(echo "$end_time - $start_time" | bc)
+sleep 0.5
+
+lines=$(grep -c '"uri":"/index.html?n=' $LOG_FILE)
+fields=$(grep '"uri":"/index.html?n=' $LOG_FILE | grep -c '"method":"GET".*"status":[0-9]*,"bytes":[0-9]*,"queue_us":[0-9]*,"service_us":[0-9]*}')
+if [ "$lines" -eq 50 ] && [ "$fields" -eq 50 ]; then
+    echo "PASSED: All 50 requests logged with status, bytes and timings in $total_time seconds"
+else
+    echo "FAILED: Expected 50 complete log lines, found $lines lines ($fields complete)"
+fi
+
+# Test 2: SIGUSR2 turns logging off, and again back on
+echo -e "\nTest 2: SIGUSR2 toggles the access log"
+kill -USR2 $SERVER_PID
+curl -s -o /dev/null "$SERVER_URL/index.html?off=1"
+kill -USR2 $SERVER_PID
+curl -s -o /dev/null "$SERVER_URL/index.html?on=1"
+sleep 0.5
+
+if ! grep -q 'off=1' $LOG_FILE && grep -q 'on=1' $LOG_FILE; then
+    echo "PASSED: Request made while logging was off was not logged"
+else
+    echo "FAILED: Expected only the request made after logging was turned back on"
+fi
+
+kill $SERVER_PID 2>/dev/null || true
+wait $SERVER_PID 2>/dev/null || true
+sleep 1
+rm -f $LOG_FILE
+
+# Test 3: sampling logs 1 in n requests, and -L 0 logs nothing
+echo -e "\nTest 3: Sampling with -L 10 and -L 0"
+./wserver -p $PORT -t 1 -b 16 -l $LOG_FILE -L 10 > /dev/null 2>&1 &
+SERVER_PID=$!
+sleep 1
+for i in $(seq 1 40); do
+    curl -s -o /dev/null "$SERVER_URL/index.html?n=$i"
+done
+sleep 0.5
+sampled=$(grep -c 'index.html' $LOG_FILE)
+kill $SERVER_PID 2>/dev/null || true
+wait $SERVER_PID 2>/dev/null || true
+sleep 1
+rm -f $LOG_FILE
+
+./wserver -p $PORT -t 1 -b 16 -l $LOG_FILE -L 0 > /dev/null 2>&1 &
+SERVER_PID=$!
+sleep 1
+for i in $(seq 1 10); do
+    curl -s -o /dev/null "$SERVER_URL/index.html?n=$i"
+done
+sleep 0.5
+disabled=$(cat $LOG_FILE 2>/dev/null | wc -l)
+
+if [ "$sampled" -eq 4 ] && [ "$disabled" -eq 0 ]; then
+    echo "PASSED: -L 10 logged $sampled of 40 requests and -L 0 logged none"
+else
+    echo "FAILED: Expected 4 lines with -L 10 and none with -L 0, got $sampled and $disabled"
+fi
+
+# Test 4: /__stats?log_sample=N changes the sampling rate while the server runs
+echo -e "\nTest 4: Changing the sampling rate at runtime"
+reply=$(curl -s "$SERVER_URL/__stats?log_sample=1")
+for i in $(seq 1 5); do
+    curl -s -o /dev/null "$SERVER_URL/index.html?runtime=$i"
+done
+bad=$(curl -s -o /dev/null -w "%{http_code}" "$SERVER_URL/__stats?log_sample=-1")
+sleep 0.5
+runtime=$(grep -c 'runtime=' $LOG_FILE)
+
+if echo "$reply" | grep -q '"sample":1' && [ "$runtime" -eq 5 ] && [ "$bad" = "400" ]; then
+    echo "PASSED: log_sample=1 turned logging on for all 5 requests and log_sample=-1 was refused"
+else
+    echo "FAILED: Expected sample 1, 5 logged requests and a 400, got $runtime requests and $bad"
+fi
+
+# Stop the server
+echo -e "\nStopping server..."
+kill $SERVER_PID 2>/dev/null || true
+wait $SERVER_PID 2>/dev/null || true
+sleep 1
+rm -f $LOG_FILE
+
+echo "Access log test completed!"
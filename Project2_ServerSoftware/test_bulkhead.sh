@@ -0,0 +1,68 @@
+#!/bin/bash
+# test_bulkhead.sh - Test script for separate static and dynamic lanes (bulkheads)
+SERVER_URL="http://localhost:8003"
+SPIN_URL="$SERVER_URL/cgi-bin/spin.cgi"
+PORT=8003
+
+echo "===== Testing Bulkheads ====="
+
+# Stop any running server
+pkill -f "wserver -p $PORT" 2>/dev/null
+sleep 1
+
+echo "<p>bulkhead test</p>" > bulkhead_test.html
+
+# Time a static request while four 2s CGI requests saturate two workers
+static_under_cgi_load() {
+    PIDS=""
+    for i in 1 2 3 4; do
+        curl -s "$SPIN_URL?2" > /dev/null &
+        PIDS="$PIDS $!"
+    done
+    sleep 0.5
+    start_time=$(date +%s.%N)
+    curl -s "$SERVER_URL/bulkhead_test.html" > /dev/null
+    end_time=$(date +%s.%N)
+    static_time=$(echo "$end_time - $start_time" | bc)
+    wait $PIDS
+}
+
+# Test 1: with one shared queue, the static file waits behind the CGI burst
+echo "Starting server with one shared lane (2 threads, 16 buffers)..."
+./wserver -p $PORT -t 2 -b 16 > /dev/null 2>&1 &
+SERVER_PID=$!
+sleep 1
+
+echo -e "\nTest 1: Static request behind a CGI burst in one lane"
+static_under_cgi_load
+echo "Static request took $static_time seconds"
+shared_time=$static_time
+
+kill $SERVER_PID 2>/dev/null || true
+wait $SERVER_PID 2>/dev/null || true
+sleep 1
+
+# Test 2: with bulkheads, the static lane keeps its own worker
+echo -e "\nStarting server with -t static=1,dynamic=2 (16 buffers per lane)..."
+./wserver -p $PORT -t static=1,dynamic=2 -b 16 > /dev/null 2>&1 &
+SERVER_PID=$!
+sleep 1
+
+echo -e "\nTest 2: Static request during the same CGI burst with separate lanes"
+static_under_cgi_load
+echo "Static request took $static_time seconds"
+
+if (( $(echo "$static_time < 0.5" | bc -l) )) && (( $(echo "$shared_time > $static_time" | bc -l) )); then
+    echo "PASSED: Static latency stayed flat while CGI was saturated ($static_time vs $shared_time seconds)"
+else
+    echo "FAILED: Expected the static request to be served at once with separate lanes"
+fi
+
+# Stop the server
+echo -e "\nStopping server..."
+kill $SERVER_PID 2>/dev/null || true
+wait $SERVER_PID 2>/dev/null || true
+rm -f bulkhead_test.html
+sleep 1
+
+echo "Bulkhead test completed!"
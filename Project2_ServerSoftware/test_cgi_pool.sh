@@ -0,0 +1,85 @@
+#!/bin/bash
+# test_cgi_pool.sh - Test script for the pre-forked CGI worker pool
+SERVER_URL="http://localhost:8003"
+SPIN_URL="$SERVER_URL/cgi-bin/spin.cgi"
+SQL_URL="$SERVER_URL/cgi-bin/sql.cgi"
+PORT=8003
+
+echo "===== Testing CGI Worker Pool ====="
+
+# Stop any running server
+pkill -f "wserver -p $PORT" 2>/dev/null
+sleep 1
+
+# Start server with 2 workers per CGI program, each replaced after 3 requests
+echo "Starting server with a CGI pool (2 workers per program, 3 requests per worker)..."
+./wserver -p $PORT -t 4 -b 8 -c 2 -C 3 > /dev/null 2>&1 &
+SERVER_PID=$!
+sleep 1
+
+# Test 1: pooled spin.cgi produces the same output as a plain CGI run
+echo -e "\nTest 1: Pooled CGI output"
+if curl -s "$SPIN_URL?1" | grep -q "I was asked to spin for 1.00 seconds"; then
+    echo "PASSED: pooled spin.cgi answered the request"
+else
+    echo "FAILED: pooled spin.cgi did not answer the request"
+fi
+
+# Test 2: workers outlive their requests
+echo -e "\nTest 2: Workers stay alive between requests"
+worker1=$(pgrep -P $SERVER_PID spin.cgi)
+curl -s "$SPIN_URL?1" > /dev/null
+worker2=$(pgrep -P $SERVER_PID spin.cgi)
+if [ -n "$worker1" ] && [ "$worker1" = "$worker2" ]; then
+    echo "PASSED: the same worker (pid $worker1) served both requests"
+else
+    echo "FAILED: expected one long-lived worker, saw '$worker1' then '$worker2'"
+fi
+
+# Test 3: a worker is replaced after 3 requests
+echo -e "\nTest 3: Worker recycling"
+curl -s "$SPIN_URL?1" > /dev/null
+curl -s "$SPIN_URL?1" > /dev/null
+worker3=$(pgrep -P $SERVER_PID spin.cgi)
+if [ -n "$worker3" ] && [ "$worker3" != "$worker1" ]; then
+    echo "PASSED: worker $worker1 was replaced by $worker3"
+else
+    echo "FAILED: worker was not replaced ('$worker1' then '$worker3')"
+fi
+
+# Test 4: the pool runs as many requests in parallel as it has workers
+echo -e "\nTest 4: Parallel requests"
+start_time=$(date +%s.%N)
+for i in {1..4}; do
+    curl -s "$SPIN_URL?1" > /dev/null &
+done
+wait $(jobs -p | grep -v "^$SERVER_PID$")
+end_time=$(date +%s.%N)
+elapsed=$(echo "$end_time - $start_time" | bc)
+if (( $(echo "$elapsed > 1.5 && $elapsed < 3" | bc -l) )); then
+    echo "PASSED: 4 requests on 2 workers took $elapsed seconds (expected ~2s)"
+else
+    echo "FAILED: 4 requests on 2 workers took $elapsed seconds (expected ~2s)"
+fi
+
+# Test 5: pooled sql.cgi
+echo -e "\nTest 5: Pooled sql.cgi"
+curl -s "$SQL_URL?CREATE%20TABLE%20pool_test%20(id%20int,%20name%20char(10))" > /dev/null
+# The table survives earlier runs, so start it empty
+curl -s "$SQL_URL?DELETE%20FROM%20pool_test%20WHERE%20id%20%3E%200" > /dev/null
+for i in {1..5}; do
+    curl -s "$SQL_URL?INSERT%20INTO%20pool_test%20VALUES%20($i,%20'row$i')" > /dev/null
+done
+if curl -s "$SQL_URL?SELECT%20*%20FROM%20pool_test" | grep -q "5 record(s) found"; then
+    echo "PASSED: 5 rows inserted and selected through pooled workers"
+else
+    echo "FAILED: pooled sql.cgi lost rows"
+fi
+
+# Stop the server
+echo -e "\nStopping server..."
+kill $SERVER_PID 2>/dev/null || true
+wait $SERVER_PID 2>/dev/null || true
+sleep 1
+
+echo "CGI pool test completed!"
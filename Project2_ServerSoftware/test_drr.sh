@@ -0,0 +1,55 @@
+#!/bin/bash
+# test_drr.sh - Test script for the DRR scheduler (fair share per client)
+SERVER_URL="http://localhost:8003"
+SPIN_URL="$SERVER_URL/cgi-bin/spin.cgi"
+PORT=8003
+
+echo "===== Testing DRR Scheduler ====="
+
+# Stop any running server
+pkill -f "wserver -p $PORT" 2>/dev/null
+sleep 1
+
+# Start server with DRR scheduler (1 thread, 10 buffers)
+echo "Starting server with DRR scheduler (1 thread, 10 buffers)..."
+./wserver -p $PORT -t 1 -b 10 -s DRR > /dev/null 2>&1 &
+SERVER_PID=$!
+sleep 1
+
+# Test: a quiet client should not wait for every request of a noisy one
+echo -e "\nTest: Fair share between a noisy and a quiet client"
+echo "Noisy client queues six 1s requests, then the quiet client sends one"
+NOISY_PIDS=""
+for i in 1 2 3 4 5 6; do
+    curl -s -H "X-Api-Key: noisy" "$SPIN_URL?1" > /dev/null &
+    NOISY_PIDS="$NOISY_PIDS $!"
+done
+sleep 0.3
+
+start_time=$(date +%s.%N)
+curl -s -H "X-Api-Key: quiet" "$SPIN_URL?1" > /dev/null
+end_time=$(date +%s.%N)
+quiet_time=$(echo "$end_time - $start_time" | bc)
+echo "Quiet client's request completed in $quiet_time seconds"
+
+wait $NOISY_PIDS
+
+# Analysis of results
+echo -e "\nAnalysis:"
+echo "With FIFO the quiet request would wait for all six noisy requests (~7s);"
+echo "with DRR it should get the next turn (~2-3s)"
+if (( $(echo "$quiet_time < 4" | bc -l) )); then
+    echo "PASSED: With DRR, the quiet client got its turn"
+    echo "   Quiet request took $quiet_time seconds (expected < 4s)"
+else
+    echo "FAILED: With DRR, the quiet client should not wait for the noisy one"
+    echo "   Quiet request took $quiet_time seconds (expected < 4s)"
+fi
+
+# Stop the server
+echo -e "\nStopping server..."
+kill $SERVER_PID 2>/dev/null || true
+wait $SERVER_PID 2>/dev/null || true
+sleep 1
+
+echo "DRR scheduler test completed!"
@@ -0,0 +1,64 @@
+#!/bin/bash
+# test_edf.sh - Test script for the EDF scheduler (X-Deadline-Ms header)
+SERVER_URL="http://localhost:8003"
+SPIN_URL="$SERVER_URL/cgi-bin/spin.cgi"
+PORT=8003
+
+echo "===== Testing EDF Scheduler ====="
+
+# Stop any running server
+pkill -f "wserver -p $PORT" 2>/dev/null
+sleep 1
+
+# Start server with EDF scheduler (1 thread, 5 buffers)
+echo "Starting server with EDF scheduler (1 thread, 5 buffers)..."
+./wserver -p $PORT -t 1 -b 5 -s EDF > /dev/null 2>&1 &
+SERVER_PID=$!
+sleep 1
+
+echo -e "\nTest: Deadline order and expired deadlines with EDF"
+echo "Occupying the worker (1s), then queueing a batch request (no deadline),"
+echo "an urgent request (5s deadline) and one that expires after 200ms"
+curl -s "$SPIN_URL?1" > /dev/null &
+BLOCK_PID=$!
+sleep 0.2
+curl -s "$SPIN_URL?1" > /dev/null &
+BATCH_PID=$!
+sleep 0.1
+( curl -s -o /dev/null -w '%{http_code}' -H "X-Deadline-Ms: 200" "$SPIN_URL?1" > /tmp/edf_expired.$$ ) &
+EXPIRED_PID=$!
+sleep 0.1
+
+start_time=$(date +%s.%N)
+curl -s -H "X-Deadline-Ms: 5000" "$SPIN_URL?1" > /dev/null
+end_time=$(date +%s.%N)
+urgent_time=$(echo "$end_time - $start_time" | bc)
+echo "Urgent request completed in $urgent_time seconds"
+
+wait $BLOCK_PID $BATCH_PID $EXPIRED_PID
+expired_code=$(cat /tmp/edf_expired.$$)
+rm -f /tmp/edf_expired.$$
+echo "Expired request answered with status $expired_code"
+
+# Analysis of results
+echo -e "\nAnalysis:"
+if (( $(echo "$urgent_time < 2.2" | bc -l) )); then
+    echo "PASSED: With EDF, the urgent request overtook the batch request"
+    echo "   Urgent request took $urgent_time seconds (expected < 2.2s)"
+else
+    echo "FAILED: With EDF, the urgent request should not wait for the batch request"
+    echo "   Urgent request took $urgent_time seconds (expected < 2.2s)"
+fi
+if [ "$expired_code" = "503" ]; then
+    echo "PASSED: The request whose deadline passed in the queue was rejected with 503"
+else
+    echo "FAILED: The request whose deadline passed should be rejected with 503, got $expired_code"
+fi
+
+# Stop the server
+echo -e "\nStopping server..."
+kill $SERVER_PID 2>/dev/null || true
+wait $SERVER_PID 2>/dev/null || true
+sleep 1
+
+echo "EDF scheduler test completed!"
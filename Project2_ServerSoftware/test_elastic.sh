@@ -0,0 +1,68 @@
+#!/bin/bash
+# test_elastic.sh - Test script for the elastic worker pool (-t min:max)
+SERVER_URL="http://localhost:8003"
+SPIN_URL="$SERVER_URL/cgi-bin/spin.cgi"
+PORT=8003
+LOG=/tmp/elastic_test.$$
+
+echo "===== Testing Elastic Worker Pool ====="
+
+# Stop any running server
+pkill -f "wserver -p $PORT" 2>/dev/null
+sleep 1
+
+echo "Starting server with -t 1:8 (64 buffers)..."
+./wserver -p $PORT -t 1:8 -b 64 > /dev/null 2> $LOG &
+SERVER_PID=$!
+sleep 1
+
+# Test 1: a burst of slow requests grows the pool instead of queueing
+echo -e "\nTest 1: Eight 1s requests at once"
+start_time=$(date +%s.%N)
+PIDS=""
+for i in 1 2 3 4 5 6 7 8; do
+    curl -s "$SPIN_URL?1" > /dev/null &
+    PIDS="$PIDS $!"
+done
+wait $PIDS
+end_time=$(date +%s.%N)
+burst_time=$(echo "$end_time - $start_time" | bc)
+
+if (( $(echo "$burst_time < 3" | bc -l) )) && grep -q "grew from 1" $LOG; then
+    echo "PASSED: Pool grew and served the burst in $burst_time seconds"
+else
+    echo "FAILED: Expected the pool to grow and serve the burst in about 1 second, took $burst_time seconds"
+fi
+
+# Test 2: the extra workers retire after they have been idle
+echo -e "\nTest 2: Waiting for idle workers to retire (about 10 seconds)..."
+sleep 11
+shrunk=$(grep -c "shrank to" $LOG)
+if [ "$shrunk" -ge 1 ] && grep -q "shrank to 1 workers" $LOG; then
+    echo "PASSED: $shrunk idle workers retired, back to the minimum of 1"
+else
+    echo "FAILED: Expected idle workers to retire down to 1"
+fi
+echo "Pool log:"
+cat $LOG
+rm -f $LOG
+
+# Test 3: the scaling decisions are exported as metrics
+echo -e "\nTest 3: Pool metrics in /__stats"
+metrics=$(curl -s "$SERVER_URL/__stats?format=prometheus")
+grown=$(echo "$metrics" | grep '^wserver_pool_grown_total{lane="all"}' | awk '{print $2}')
+retired=$(echo "$metrics" | grep '^wserver_pool_shrunk_total{lane="all"}' | awk '{print $2}')
+peak=$(echo "$metrics" | grep '^wserver_pool_peak_workers{lane="all"}' | awk '{print $2}')
+if [ "${grown:-0}" -ge 1 ] && [ "$retired" = "$shrunk" ] && [ "${peak:-0}" -gt 1 ]; then
+    echo "PASSED: Metrics report $grown workers grown, $retired shrunk and a peak of $peak"
+else
+    echo "FAILED: Expected grown, shrunk ($shrunk) and peak metrics, got '$grown', '$retired' and '$peak'"
+fi
+
+# Stop the server
+echo -e "\nStopping server..."
+kill $SERVER_PID 2>/dev/null || true
+wait $SERVER_PID 2>/dev/null || true
+sleep 1
+
+echo "Elastic worker pool test completed!"
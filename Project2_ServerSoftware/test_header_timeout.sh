@@ -0,0 +1,62 @@
+#!/bin/bash
+# test_header_timeout.sh - Test script for the header timeout (-H)
+SERVER_URL="http://localhost:8003"
+PORT=8003
+
+echo "===== Testing Header Timeout ====="
+
+# Stop any running server
+pkill -f "wserver -p $PORT" 2>/dev/null
+sleep 1
+
+# Keep-alive is off, so only the header timeout can close a slow client
+echo "Starting server with -H 2 -k 0 (1 thread, 1 buffer)..."
+./wserver -p $PORT -t 1 -b 1 -H 2 -k 0 > /dev/null 2>&1 &
+SERVER_PID=$!
+sleep 1
+
+# Test 1: a client trickling its headers is closed once the timeout passes
+echo -e "\nTest 1: Client sending one header line every 0.5s for 10s"
+start_time=$(date +%s.%N)
+(
+    trap '' PIPE
+    exec 3<>/dev/tcp/localhost/$PORT || exit 1
+    printf 'GET / HTTP/1.1\r\nHost: localhost\r\n' >&3
+    for i in $(seq 1 20); do
+        sleep 0.5
+        printf 'X-Slow: %d\r\n' $i >&3 2>/dev/null || exit 0
+    done
+) &
+SLOW_PID=$!
+
+# Test 2: a normal request is not held up by the slow client
+sleep 0.5
+echo -e "\nTest 2: Normal request while the slow client is connected"
+fast_start=$(date +%s.%N)
+code=$(curl -s -o /dev/null -w '%{http_code}' --max-time 5 "$SERVER_URL/index.html")
+fast_end=$(date +%s.%N)
+fast_time=$(echo "$fast_end - $fast_start" | bc)
+
+if [ "$code" != "000" ] && (( $(echo "$fast_time < 1" | bc -l) )); then
+    echo "PASSED: Served with status $code in $fast_time seconds"
+else
+    echo "FAILED: Expected a prompt response, got status $code after $fast_time seconds"
+fi
+
+wait $SLOW_PID
+end_time=$(date +%s.%N)
+slow_time=$(echo "$end_time - $start_time" | bc)
+
+if (( $(echo "$slow_time < 5" | bc -l) )); then
+    echo "PASSED: Slow client was disconnected after $slow_time seconds"
+else
+    echo "FAILED: Expected the slow client to be disconnected after about 2 seconds, took $slow_time seconds"
+fi
+
+# Stop the server
+echo -e "\nStopping server..."
+kill $SERVER_PID 2>/dev/null || true
+wait $SERVER_PID 2>/dev/null || true
+sleep 1
+
+echo "Header timeout test completed!"
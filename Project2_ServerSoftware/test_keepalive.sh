@@ -0,0 +1,68 @@
+#!/bin/bash
+# test_keepalive.sh - Test script for HTTP/1.1 persistent connections
+SERVER_URL="http://localhost:8003"
+SPIN_URL="$SERVER_URL/cgi-bin/spin.cgi"
+PORT=8003
+
+echo "===== Testing Keep-Alive Connections ====="
+
+# Stop any running server
+pkill -f "wserver -p $PORT" 2>/dev/null
+sleep 1
+
+# Start server with a 2 second idle timeout and 3 requests per connection
+echo "Starting server with keep-alive (2s timeout, 3 requests per connection)..."
+echo "<p>keep-alive test</p>" > keepalive_test.html
+./wserver -p $PORT -t 2 -b 8 -k 2 -r 3 > /dev/null 2>&1 &
+SERVER_PID=$!
+sleep 1
+
+# Test 1: static and CGI responses reuse one connection
+echo -e "\nTest 1: Connection reuse across static and CGI requests"
+connects=$(curl -sv "$SERVER_URL/keepalive_test.html" "$SPIN_URL?1" "$SERVER_URL/keepalive_test.html" 2>&1 | grep -c "^\* Connected to")
+if [ "$connects" -eq 1 ]; then
+    echo "PASSED: 3 requests were served over 1 connection"
+else
+    echo "FAILED: expected 1 connection, curl opened $connects"
+fi
+
+# Test 2: max requests per connection
+echo -e "\nTest 2: Max requests per connection"
+connects=$(curl -sv "$SERVER_URL/keepalive_test.html" "$SERVER_URL/keepalive_test.html" "$SERVER_URL/keepalive_test.html" "$SERVER_URL/keepalive_test.html" 2>&1 | grep -c "^\* Connected to")
+if [ "$connects" -eq 2 ]; then
+    echo "PASSED: server closed the connection after 3 requests"
+else
+    echo "FAILED: expected 2 connections, curl opened $connects"
+fi
+
+# Test 3: CGI output without Content-Length is sent chunked
+echo -e "\nTest 3: Chunked framing for CGI output"
+if curl -sv "$SPIN_URL?1" 2>&1 | grep -qi "^< Transfer-Encoding: chunked"; then
+    echo "PASSED: CGI response used chunked encoding"
+else
+    echo "FAILED: CGI response was not chunked"
+fi
+
+# Test 4: idle connections are closed after the timeout
+echo -e "\nTest 4: Idle timeout"
+start_time=$(date +%s.%N)
+exec 3<>/dev/tcp/localhost/$PORT
+printf "GET /keepalive_test.html HTTP/1.1\r\nHost: localhost\r\n\r\n" >&3
+timeout 10 cat <&3 > /dev/null
+exec 3<&-
+end_time=$(date +%s.%N)
+idle_time=$(echo "$end_time - $start_time" | bc)
+if (( $(echo "$idle_time > 1.5 && $idle_time < 5" | bc -l) )); then
+    echo "PASSED: idle connection closed after $idle_time seconds (expected ~2s)"
+else
+    echo "FAILED: idle connection closed after $idle_time seconds (expected ~2s)"
+fi
+
+# Stop the server
+echo -e "\nStopping server..."
+kill $SERVER_PID 2>/dev/null || true
+wait $SERVER_PID 2>/dev/null || true
+rm -f keepalive_test.html
+sleep 1
+
+echo "Keep-alive test completed!"
@@ -0,0 +1,76 @@
+#!/bin/bash
+# test_overload.sh - Test script for admission control (-o reject and -o codel)
+SERVER_URL="http://localhost:8003"
+SPIN_URL="$SERVER_URL/cgi-bin/spin.cgi"
+PORT=8003
+
+echo "===== Testing Admission Control ====="
+
+# Stop any running server
+pkill -f "wserver -p $PORT" 2>/dev/null
+sleep 1
+
+# Test 1: a full queue answers at once with 503 and Retry-After
+echo "Starting server with -o reject (1 thread, 1 buffer)..."
+./wserver -p $PORT -t 1 -b 1 -o reject > /dev/null 2>&1 &
+SERVER_PID=$!
+sleep 1
+
+echo -e "\nTest 1: Request arriving at a full queue"
+curl -s "$SPIN_URL?2" > /dev/null &
+BLOCK_PID=$!
+sleep 0.3
+curl -s "$SPIN_URL?1" > /dev/null &
+QUEUED_PID=$!
+sleep 0.3
+
+start_time=$(date +%s.%N)
+headers=$(curl -s -D - -o /dev/null "$SPIN_URL?1")
+end_time=$(date +%s.%N)
+reject_time=$(echo "$end_time - $start_time" | bc)
+wait $BLOCK_PID $QUEUED_PID
+
+if echo "$headers" | grep -q "^HTTP/1.1 503" && echo "$headers" | grep -qi "^Retry-After:" &&
+   (( $(echo "$reject_time < 0.5" | bc -l) )); then
+    echo "PASSED: Rejected with 503 and Retry-After in $reject_time seconds"
+else
+    echo "FAILED: Expected an immediate 503 with Retry-After, took $reject_time seconds"
+    echo "$headers"
+fi
+
+kill $SERVER_PID 2>/dev/null || true
+wait $SERVER_PID 2>/dev/null || true
+sleep 1
+
+# Test 2: CoDel sheds requests once the queue wait stays above target
+echo -e "\nStarting server with -o codel -T 100 (1 thread, 20 buffers)..."
+./wserver -p $PORT -t 1 -b 20 -o codel -T 100 > /dev/null 2>&1 &
+SERVER_PID=$!
+sleep 1
+
+echo -e "\nTest 2: Ten 1s requests at once, far more than one worker can serve"
+rm -f /tmp/overload_codes.$$
+PIDS=""
+for i in 1 2 3 4 5 6 7 8 9 10; do
+    curl -s -o /dev/null -w '%{http_code}\n' "$SPIN_URL?1" >> /tmp/overload_codes.$$ &
+    PIDS="$PIDS $!"
+done
+wait $PIDS
+served=$(grep -c '^200' /tmp/overload_codes.$$)
+shed=$(grep -c '^503' /tmp/overload_codes.$$)
+rm -f /tmp/overload_codes.$$
+echo "Served $served requests, shed $shed"
+
+if [ "$served" -ge 1 ] && [ "$shed" -ge 1 ] && [ $((served + shed)) -eq 10 ]; then
+    echo "PASSED: CoDel served the first requests and shed the ones that queued too long"
+else
+    echo "FAILED: Expected some requests served and the rest shed with 503"
+fi
+
+# Stop the server
+echo -e "\nStopping server..."
+kill $SERVER_PID 2>/dev/null || true
+wait $SERVER_PID 2>/dev/null || true
+sleep 1
+
+echo "Admission control test completed!"
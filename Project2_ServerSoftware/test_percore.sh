@@ -0,0 +1,55 @@
+#!/bin/bash
+# test_percore.sh - Test script for per-core instances with SO_REUSEPORT listeners (-m percore)
+SERVER_URL="http://localhost:8003"
+SPIN_URL="$SERVER_URL/cgi-bin/spin.cgi"
+PORT=8003
+
+echo "===== Testing Per-Core Mode ====="
+
+# Stop any running server
+pkill -f "wserver -p $PORT" 2>/dev/null
+sleep 1
+
+echo "Starting server with -m percore:4 (1 thread, 16 buffers per instance)..."
+./wserver -p $PORT -m percore:4 -t 1 -b 16 > /dev/null 2>&1 &
+SERVER_PID=$!
+sleep 1
+
+# Test 1: every instance has its own listener on the port
+echo -e "\nTest 1: Listening sockets on port $PORT"
+listeners=$(ss -ltn "sport = :$PORT" | grep -c LISTEN)
+if [ "$listeners" -eq 4 ]; then
+    echo "PASSED: 4 instances listen on port $PORT"
+else
+    echo "FAILED: Expected 4 listening sockets, found $listeners"
+fi
+
+# Test 2: the kernel spreads connections by a hash of the client port, so
+# instances serve in parallel, though not always evenly
+echo -e "\nTest 2: Eight 1s requests on separate connections"
+start_time=$(date +%s.%N)
+rm -f /tmp/percore_codes.$$
+PIDS=""
+for i in 1 2 3 4 5 6 7 8; do
+    curl -s -o /dev/null -w '%{http_code}\n' "$SPIN_URL?1" >> /tmp/percore_codes.$$ &
+    PIDS="$PIDS $!"
+done
+wait $PIDS
+end_time=$(date +%s.%N)
+total_time=$(echo "$end_time - $start_time" | bc)
+served=$(grep -c '^200' /tmp/percore_codes.$$)
+rm -f /tmp/percore_codes.$$
+
+if [ "$served" -eq 8 ] && (( $(echo "$total_time < 7" | bc -l) )); then
+    echo "PASSED: All 8 requests served in $total_time seconds (one worker alone needs 8)"
+else
+    echo "FAILED: Expected 8 requests served in parallel, got $served in $total_time seconds"
+fi
+
+# Stop the server
+echo -e "\nStopping server..."
+kill $SERVER_PID 2>/dev/null || true
+wait $SERVER_PID 2>/dev/null || true
+sleep 1
+
+echo "Per-core mode test completed!"
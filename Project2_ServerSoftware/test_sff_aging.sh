@@ -0,0 +1,58 @@
+#!/bin/bash
+# test_sff_aging.sh - Test script for the SFF-AGING scheduler (maximum queue wait)
+SERVER_URL="http://localhost:8003"
+SPIN_URL="$SERVER_URL/cgi-bin/spin.cgi"
+PORT=8003
+
+echo "===== Testing SFF-AGING Scheduler ====="
+
+# Stop any running server
+pkill -f "wserver -p $PORT" 2>/dev/null
+sleep 1
+
+# Start server with SFF-AGING (1 thread, 10 buffers, 1.5s maximum wait)
+echo "Starting server with SFF-AGING scheduler (1 thread, 10 buffers, -w 1500)..."
+./wserver -p $PORT -t 1 -b 10 -s SFF-AGING -w 1500 > /dev/null 2>&1 &
+SERVER_PID=$!
+sleep 1
+
+# Test: a large request must not wait behind every smaller one
+echo -e "\nTest: Large request under a stream of small requests"
+echo "Occupying the worker (1s), queueing a 2s request, then four 1s requests"
+start_time=$(date +%s.%N)
+curl -s "$SPIN_URL?1" > /dev/null &
+BLOCK_PID=$!
+sleep 0.2
+( curl -s "$SPIN_URL?2" > /dev/null; date +%s.%N > /tmp/sff_aging_large.$$ ) &
+LARGE_PID=$!
+sleep 0.2
+SMALL_PIDS=""
+for i in 1 2 3 4; do
+    curl -s "$SPIN_URL?1" > /dev/null &
+    SMALL_PIDS="$SMALL_PIDS $!"
+done
+
+wait $BLOCK_PID $LARGE_PID $SMALL_PIDS
+large_time=$(echo "$(cat /tmp/sff_aging_large.$$) - $start_time" | bc)
+rm -f /tmp/sff_aging_large.$$
+echo "Large request completed after $large_time seconds"
+
+# Analysis of results
+echo -e "\nAnalysis:"
+echo "With plain SFF the large request would run last and finish after ~7s;"
+echo "once it has waited 1.5s it should go next and finish after ~4s"
+if (( $(echo "$large_time < 5.5" | bc -l) )); then
+    echo "PASSED: The maximum wait let the large request overtake the small ones"
+    echo "   Large request took $large_time seconds (expected < 5.5s)"
+else
+    echo "FAILED: The large request was starved by the small ones"
+    echo "   Large request took $large_time seconds (expected < 5.5s)"
+fi
+
+# Stop the server
+echo -e "\nStopping server..."
+kill $SERVER_PID 2>/dev/null || true
+wait $SERVER_PID 2>/dev/null || true
+sleep 1
+
+echo "SFF-AGING scheduler test completed!"
@@ -0,0 +1,61 @@
+#!/bin/bash
+# test_sjf.sh - Test script for the SJF scheduler (predicted service time per request class)
+SERVER_URL="http://localhost:8003"
+SPIN_URL="$SERVER_URL/cgi-bin/spin.cgi"
+PORT=8003
+
+echo "===== Testing SJF Scheduler ====="
+
+# Stop any running server
+pkill -f "wserver -p $PORT" 2>/dev/null
+sleep 1
+
+echo "<p>sjf</p>" > sjf_test.html
+
+# Start server with SJF scheduler (1 thread, 5 buffers)
+echo "Starting server with SJF scheduler (1 thread, 5 buffers)..."
+./wserver -p $PORT -t 1 -b 5 -s SJF > /dev/null 2>&1 &
+SERVER_PID=$!
+sleep 1
+
+# Teach the predictor how long each class takes
+echo -e "\nWarming up: one 2s spin request and one static file"
+curl -s "$SPIN_URL?2" > /dev/null
+curl -s "$SERVER_URL/sjf_test.html" > /dev/null
+
+# Test: a static file queued behind a slow dynamic request should go first
+echo -e "\nTest: Request Order with SJF"
+echo "Occupying the worker (1s), queueing a 2s request, then a static file"
+curl -s "$SPIN_URL?1" > /dev/null &
+BLOCK_PID=$!
+sleep 0.3
+curl -s "$SPIN_URL?2" > /dev/null &
+LARGE_PID=$!
+sleep 0.3
+
+start_time=$(date +%s.%N)
+out=$(curl -s "$SERVER_URL/sjf_test.html")
+end_time=$(date +%s.%N)
+small_time=$(echo "$end_time - $start_time" | bc)
+echo "Static file completed in $small_time seconds"
+
+wait $BLOCK_PID $LARGE_PID
+
+# Analysis of results
+echo -e "\nAnalysis:"
+if [ "$out" = "<p>sjf</p>" ] && (( $(echo "$small_time < 1.8" | bc -l) )); then
+    echo "PASSED: With SJF, the static file was served before the queued 2s request"
+    echo "   Static file took $small_time seconds (expected < 1.8s)"
+else
+    echo "FAILED: With SJF, the static file should not wait for the queued 2s request"
+    echo "   Static file took $small_time seconds (expected < 1.8s)"
+fi
+
+# Stop the server
+echo -e "\nStopping server..."
+kill $SERVER_PID 2>/dev/null || true
+wait $SERVER_PID 2>/dev/null || true
+rm -f sjf_test.html
+sleep 1
+
+echo "SJF scheduler test completed!"
@@ -0,0 +1,71 @@
+#!/bin/bash
+# test_stats.sh - Test script for the /__stats endpoint
+SERVER_URL="http://localhost:8003"
+PORT=8003
+
+echo "===== Testing Stats Endpoint ====="
+
+# Stop any running server
+pkill -f "wserver -p $PORT" 2>/dev/null
+sleep 1
+
+echo "Starting server (4 threads, 16 buffers, SFF scheduling)..."
+./wserver -p $PORT -t 4 -b 16 -s SFF -l /dev/null > /dev/null 2>&1 &
+SERVER_PID=$!
+sleep 1
+
+# Test 1: every concurrent request is counted, with no count lost between threads
+echo -e "\nTest 1: 50 concurrent static requests and 3 SQL statements"
+start_time=$(date +%s.%N)
+for i in $(seq 1 50); do
+    curl -s -o /dev/null "$SERVER_URL/index.html?n=$i" &
+done
+wait $(jobs -p | grep -v "^$SERVER_PID$")
+curl -s -o /dev/null "$SERVER_URL/sql?CREATE%20TABLE%20stats_test%20(id%20INT,%20name%20TEXT)"
+curl -s -o /dev/null "$SERVER_URL/sql?INSERT%20INTO%20stats_test%20VALUES%20(1,%20'a')"
+curl -s -o /dev/null "$SERVER_URL/sql?SELECT%20*%20FROM%20stats_test"
+end_time=$(date +%s.%N)
+total_time=$(echo "$end_time - $start_time" | bc)
+
+stats=$(curl -s "$SERVER_URL/__stats")
+static_count=$(echo "$stats" | grep -o '"service_us":{"static":{"count":[0-9]*' | grep -o '[0-9]*$')
+accepted=$(echo "$stats" | grep -o '"accepted":[0-9]*' | grep -o '[0-9]*$')
+dequeued=$(echo "$stats" | grep -o '"policy":"SFF","depth":[0-9]*,"enqueued":[0-9]*,"dequeued":[0-9]*' | grep -o '[0-9]*$')
+sql_kinds=$(echo "$stats" | grep -o '"sql_\(create\|insert\|select\)":{"count":1' | wc -l)
+
+if [ "$static_count" = "50" ] && [ "$accepted" -ge 54 ] && [ "$dequeued" -ge 54 ] && [ "$sql_kinds" -eq 6 ]; then
+    echo "PASSED: 50 static requests, $accepted accepts, $dequeued SFF dequeues and each SQL statement type counted ($total_time seconds)"
+else
+    echo "FAILED: Expected 50 static requests, 54 accepts and dequeues and one of each SQL type, got $static_count, $accepted, $dequeued and $sql_kinds"
+fi
+
+# Test 2: the JSON reports the queue gauge and the workers
+echo -e "\nTest 2: Gauges in the JSON output"
+if echo "$stats" | grep -q '"buffer_count":[0-9]*' && echo "$stats" | grep -q '"workers":4,"busy":[0-9]*,"idle":[0-9]*' &&
+    echo "$stats" | grep -q '"accept_rate":[0-9.]*' &&
+    echo "$stats" | grep -q '"classes":\[{"enqueued":[0-9]*,"dequeued":[0-9]*,"wait_total_us":[0-9]*,"wait_max_us":[0-9]*}'; then
+    echo "PASSED: buffer_count, accept_rate, busy/idle workers and per-class waits reported"
+else
+    echo "FAILED: Expected buffer_count, accept_rate, 4 workers and per-class waits in $stats"
+fi
+
+# Test 3: the Prometheus variant has cumulative histogram buckets
+echo -e "\nTest 3: Prometheus text format"
+metrics=$(curl -s "$SERVER_URL/__stats?format=prometheus")
+inf=$(echo "$metrics" | grep 'wserver_service_seconds_bucket{kind="static",le="+Inf"}' | awk '{print $2}')
+if echo "$metrics" | grep -q '^# TYPE wserver_queue_wait_seconds histogram' &&
+    echo "$metrics" | grep -q '^wserver_sched_dequeued_total{lane="all",policy="SFF"} [0-9]*' &&
+    echo "$metrics" | grep -q '^wserver_cgi_spawns_total 0' && [ "$inf" = "50" ]; then
+    echo "PASSED: Prometheus output has counters, gauges and histograms"
+else
+    echo "FAILED: Prometheus output is missing metrics"
+fi
+
+# Stop the server
+echo -e "\nStopping server..."
+kill $SERVER_PID 2>/dev/null || true
+wait $SERVER_PID 2>/dev/null || true
+sleep 1
+rm -f stats_test.dat
+
+echo "Stats endpoint test completed!"
@@ -0,0 +1,67 @@
+#!/bin/bash
+# test_trace.sh - Test script for request tracing (-x, -R, SIGUSR1 and Server-Timing)
+SERVER_URL="http://localhost:8003"
+PORT=8003
+TRACE_FILE="trace_test.json"
+
+echo "===== Testing Request Tracing ====="
+
+# Stop any running server
+pkill -f "wserver -p $PORT" 2>/dev/null
+sleep 1
+rm -f $TRACE_FILE wserver-trace-*.json
+
+echo "Starting server with -x $TRACE_FILE -R 10 (4 threads, 16 buffers)..."
+./wserver -p $PORT -t 4 -b 16 -l /dev/null -x $TRACE_FILE -R 10 > /dev/null 2>&1 &
+SERVER_PID=$!
+sleep 1
+
+# Test 1: responses carry the phases the request went through
+echo -e "\nTest 1: Server-Timing response header"
+timing=$(curl -s -D - -o /dev/null "$SERVER_URL/sql?SELECT%201" | grep -i '^Server-Timing:')
+if echo "$timing" | grep -q 'read;dur=[0-9.]*, queue;dur=[0-9.]*, handler;dur=[0-9.]*'; then
+    echo "PASSED: $timing"
+else
+    echo "FAILED: Expected read, queue and handler durations, got '$timing'"
+fi
+
+# Test 2: every request appears in the trace file with its phases
+echo -e "\nTest 2: 30 concurrent requests in the trace file"
+start_time=$(date +%s.%N)
+for i in $(seq 1 30); do
+    curl -s -o /dev/null "$SERVER_URL/index.html?n=$i" &
+done
+wait $(jobs -p | grep -v "^$SERVER_PID$")
+end_time=$(date +%s.%N)
+total_time=$(echo "$end_time - $start_time" | bc)
+sleep 0.5
+
+handlers=$(grep -c '"name":"handler".*"uri":"/index.html?n=' $TRACE_FILE)
+queues=$(grep -c '"name":"queue","cat":"request","ph":"e"' $TRACE_FILE)
+if head -1 $TRACE_FILE | grep -q '^\[$' && [ "$handlers" -eq 30 ] && [ "$queues" -eq 31 ]; then
+    echo "PASSED: Trace file has read, queue and handler events for all requests ($total_time seconds)"
+else
+    echo "FAILED: Expected 30 handler events and 31 queue slices, got $handlers and $queues"
+fi
+
+# Test 3: SIGUSR1 dumps the last 10 requests as a complete trace
+echo -e "\nTest 3: SIGUSR1 flight recorder dump"
+kill -USR1 $SERVER_PID
+sleep 0.5
+dump=$(ls wserver-trace-$SERVER_PID.json 2>/dev/null)
+dumped=$(grep -c '"name":"handler"' "$dump" 2>/dev/null)
+if [ -n "$dump" ] && head -1 "$dump" | grep -q '^{"traceEvents":\[$' && tail -1 "$dump" | grep -q '^\],"displayTimeUnit":"ms"}$' &&
+    [ "$dumped" -eq 10 ]; then
+    echo "PASSED: $dump holds the last $dumped requests"
+else
+    echo "FAILED: Expected a dump of 10 requests, got '$dump' with $dumped"
+fi
+
+# Stop the server
+echo -e "\nStopping server..."
+kill $SERVER_PID 2>/dev/null || true
+wait $SERVER_PID 2>/dev/null || true
+sleep 1
+rm -f $TRACE_FILE wserver-trace-*.json
+
+echo "Request tracing test completed!"
@@ -0,0 +1,299 @@
+#define _GNU_SOURCE
+#include <pthread.h>
+#include "trace.h"
+#include "mpmc.h"
+
+// finished requests go into one ring of the most recent ones, each slot
+// guarded by a sequence number: the writing thread makes it odd while it
+// copies the request in, so a reader can tell a slot it raced with and skip
+// it. A background thread appends new slots to the trace file and, on
+// SIGUSR1, writes the whole ring (the flight recorder) to the dump file.
+// Both files use the Chrome trace event format, so they open in
+// chrome://tracing or Perfetto
+
+typedef struct
+{
+  _Atomic unsigned long long seq; // 2 * request number + 2 once written, odd while being written
+  int tid;                        // thread that finished the request
+  int status;
+  long long bytes;
+  long long queued_us;
+  request_trace_t trace;
+  char method[8];
+  char uri[128];
+} trace_slot_t;
+
+static trace_slot_t *ring;
+static int ring_size;
+static int recorder_size;
+static _Alignas(CACHE_LINE) _Atomic unsigned long long next_request;
+static _Atomic int dump_requested;
+
+static int trace_fd = -1;
+static const char *dump_file;
+static int pid;
+static __thread int my_tid;
+
+/**
+ * copies a request out of its slot
+ *
+ * @return 0 on success, -1 if the slot no longer holds the request or was
+ *         being written meanwhile
+ */
+static int trace_read(unsigned long long request, trace_slot_t *out)
+{
+  trace_slot_t *slot = &ring[request % ring_size];
+  unsigned long long seq = 2 * request + 2;
+  if (atomic_load_explicit(&slot->seq, memory_order_acquire) != seq)
+    return -1;
+  out->tid = slot->tid;
+  out->status = slot->status;
+  out->bytes = slot->bytes;
+  out->queued_us = slot->queued_us;
+  out->trace = slot->trace;
+  memcpy(out->method, slot->method, sizeof(out->method));
+  memcpy(out->uri, slot->uri, sizeof(out->uri));
+  atomic_thread_fence(memory_order_acquire);
+  return atomic_load_explicit(&slot->seq, memory_order_relaxed) == seq ? 0 : -1;
+}
+
+/**
+ * appends a string as a JSON string, escaping quotes, backslashes and
+ * control characters
+ */
+static int trace_escape(char *out, const char *s)
+{
+  int len = 0;
+  out[len++] = '"';
+  for (; *s; s++)
+  {
+    unsigned char c = (unsigned char)*s;
+    if (c == '"' || c == '\\')
+    {
+      out[len++] = '\\';
+      out[len++] = c;
+    }
+    else if (c < 0x20 || c == 0x7f)
+    {
+      len += sprintf(out + len, "\\u%04x", c);
+    }
+    else
+    {
+      out[len++] = c;
+    }
+  }
+  out[len++] = '"';
+  return len;
+}
+
+/**
+ * formats one request as Chrome trace events: reading the headers and
+ * waiting in the queue as async slices of the request, which overlap with
+ * other requests', and serving it as a complete slice on the worker's thread
+ *
+ * @param out room for at least 2048 bytes
+ * @param sep written after every event
+ * @return the length of the events
+ */
+static int trace_format(char *out, unsigned long long request, const trace_slot_t *slot, const char *sep)
+{
+  const request_trace_t *t = &slot->trace;
+  int len = 0;
+
+  if (t->start_us && t->parsed_us)
+  {
+    len += sprintf(out + len, "{\"name\":\"read\",\"cat\":\"request\",\"ph\":\"b\",\"id\":%llu,\"ts\":%lld,\"pid\":%d,\"tid\":%d}%s"
+                              "{\"name\":\"read\",\"cat\":\"request\",\"ph\":\"e\",\"id\":%llu,\"ts\":%lld,\"pid\":%d,\"tid\":%d}%s",
+                   request, t->start_us, pid, slot->tid, sep, request, t->parsed_us, pid, slot->tid, sep);
+  }
+  if (slot->queued_us && t->dequeued_us)
+  {
+    len += sprintf(out + len, "{\"name\":\"queue\",\"cat\":\"request\",\"ph\":\"b\",\"id\":%llu,\"ts\":%lld,\"pid\":%d,\"tid\":%d}%s"
+                              "{\"name\":\"queue\",\"cat\":\"request\",\"ph\":\"e\",\"id\":%llu,\"ts\":%lld,\"pid\":%d,\"tid\":%d}%s",
+                   request, slot->queued_us, pid, slot->tid, sep, request, t->dequeued_us, pid, slot->tid, sep);
+  }
+
+  // a request shed before a worker served it has only its answer to show
+  long long begin = t->handler_us ? t->handler_us : t->dequeued_us ? t->dequeued_us : t->parsed_us;
+  len += sprintf(out + len, "{\"name\":\"%s\",\"cat\":\"request\",\"ph\":\"X\",\"ts\":%lld,\"dur\":%lld,\"pid\":%d,\"tid\":%d,"
+                            "\"args\":{\"request\":%llu,\"method\":",
+                 t->handler_us ? "handler" : "rejected", begin, t->done_us - begin, pid, slot->tid, request);
+  len += trace_escape(out + len, slot->method);
+  len += sprintf(out + len, ",\"uri\":");
+  len += trace_escape(out + len, slot->uri);
+  len += sprintf(out + len, ",\"status\":%d,\"bytes\":%lld,\"accept_ts\":%lld,\"first_byte_us\":%lld}}%s",
+                 slot->status, slot->bytes, t->accepted_us, t->first_byte_us ? t->first_byte_us - begin : -1, sep);
+  return len;
+}
+
+/**
+ * formats the given requests into fd a buffer at a time; requests already
+ * overwritten are skipped
+ *
+ * @return the number of requests written
+ */
+static int trace_write(int fd, unsigned long long from, unsigned long long to, const char *sep)
+{
+  static char buf[64 * 1024];
+  trace_slot_t slot;
+  int len = 0, count = 0;
+
+  for (unsigned long long request = from; request < to; request++)
+  {
+    if (trace_read(request, &slot) < 0)
+      continue;
+    if (len > (int)sizeof(buf) - 2048)
+    {
+      writen(fd, buf, len);
+      len = 0;
+    }
+    len += trace_format(buf + len, request, &slot, sep);
+    count++;
+  }
+  if (len > 0)
+    writen(fd, buf, len);
+  return count;
+}
+
+/**
+ * writes the flight recorder as a complete trace to the dump file
+ */
+static void trace_write_dump(void)
+{
+  unsigned long long to = atomic_load(&next_request);
+  unsigned long long from = to > (unsigned long long)recorder_size ? to - recorder_size : 0;
+
+  int fd = open(dump_file, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+  if (fd < 0)
+  {
+    fprintf(stderr, "trace: could not open %s: %s\n", dump_file, strerror(errno));
+    return;
+  }
+  const char *head = "{\"traceEvents\":[\n";
+  const char *tail = "{\"name\":\"dump\",\"ph\":\"M\",\"pid\":0}\n],\"displayTimeUnit\":\"ms\"}\n";
+  writen(fd, head, strlen(head));
+  int count = trace_write(fd, from, to, ",\n");
+  // every event ends with a comma; an empty metadata event closes the list
+  writen(fd, tail, strlen(tail));
+  close(fd);
+  fprintf(stderr, "trace: wrote the last %d requests to %s\n", count, dump_file);
+}
+
+static void *trace_writer(void *arg)
+{
+  unsigned long long written = 0;
+  while (1)
+  {
+    usleep(TRACE_FLUSH_MS * 1000);
+    if (trace_fd >= 0)
+    {
+      // requests the ring has already dropped are lost to the file
+      unsigned long long to = atomic_load(&next_request);
+      if (to - written > (unsigned long long)ring_size)
+        written = to - ring_size;
+      trace_write(trace_fd, written, to, ",\n");
+      written = to;
+    }
+    if (atomic_exchange(&dump_requested, 0))
+    {
+      if (recorder_size > 0)
+        trace_write_dump();
+      else
+        fprintf(stderr, "trace: the flight recorder is off (-R 0)\n");
+    }
+  }
+  return NULL;
+}
+
+/**
+ * sets up tracing and starts the writer thread
+ *
+ * @param path the trace file, truncated, or NULL for none
+ * @param recorder requests the flight recorder keeps
+ * @param dump_path where SIGUSR1 writes the flight recorder
+ * @return 0 on success, -1 if the file could not be opened or memory ran out
+ */
+int trace_init(const char *path, int recorder, const char *dump_path)
+{
+  pid = getpid();
+  recorder_size = recorder;
+  dump_file = dump_path;
+  ring_size = recorder;
+  if (path && ring_size < TRACE_FILE_RING)
+    ring_size = TRACE_FILE_RING;
+  if (ring_size == 0)
+    return 0;
+
+  ring = (trace_slot_t *)calloc(ring_size, sizeof(trace_slot_t));
+  if (!ring)
+    return -1;
+  if (path)
+  {
+    trace_fd = open(path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (trace_fd < 0)
+      return -1;
+    // the array form lets the file end anywhere, so it is valid while it grows
+    writen(trace_fd, "[\n", 2);
+  }
+
+  pthread_t writer;
+  if (pthread_create(&writer, NULL, trace_writer, NULL) != 0)
+    return -1;
+  pthread_detach(writer);
+  return 0;
+}
+
+/**
+ * records a finished request; call once its response is complete
+ *
+ * @param conn the connection, before it is handed back or closed
+ */
+void trace_request(conn_t *conn)
+{
+  conn->trace.done_us = now_usec();
+  if (!ring)
+    return;
+  if (!my_tid)
+    my_tid = gettid();
+
+  unsigned long long request = atomic_fetch_add_explicit(&next_request, 1, memory_order_relaxed);
+  trace_slot_t *slot = &ring[request % ring_size];
+  atomic_store_explicit(&slot->seq, 2 * request + 1, memory_order_relaxed);
+  atomic_thread_fence(memory_order_release);
+  slot->tid = my_tid;
+  slot->status = conn->status;
+  slot->bytes = conn->bytes_sent;
+  slot->queued_us = conn->queued_us;
+  slot->trace = conn->trace;
+  http_slice_copy(&conn->req.method, slot->method, sizeof(slot->method));
+  http_slice_copy(&conn->req.uri, slot->uri, sizeof(slot->uri));
+  atomic_store_explicit(&slot->seq, 2 * request + 2, memory_order_release);
+}
+
+/**
+ * asks the writer thread to dump the flight recorder; only touches a
+ * lock-free atomic, so it may be called from a signal handler
+ */
+void trace_dump(void)
+{
+  atomic_store(&dump_requested, 1);
+}
+
+/**
+ * writes a Server-Timing header line with the phases the request has been
+ * through so far, in milliseconds
+ *
+ * @param buf room for at least 128 bytes
+ * @return the length of the line
+ */
+int trace_server_timing(conn_t *conn, char *buf)
+{
+  const request_trace_t *t = &conn->trace;
+  int len = sprintf(buf, "Server-Timing: read;dur=%.3f", t->parsed_us > t->start_us ? (t->parsed_us - t->start_us) / 1000.0 : 0.0);
+  if (t->dequeued_us)
+    len += sprintf(buf + len, ", queue;dur=%.3f", (t->dequeued_us - conn->queued_us) / 1000.0);
+  if (t->handler_us)
+    len += sprintf(buf + len, ", handler;dur=%.3f", (now_usec() - t->handler_us) / 1000.0);
+  len += sprintf(buf + len, "\r\n");
+  return len;
+}
@@ -0,0 +1,16 @@
+#ifndef __TRACE_H__
+#define __TRACE_H__
+
+#include "reactor.h"
+
+// tracing settings
+#define DEFAULT_TRACE_RECORDER 256 // finished requests the flight recorder keeps (-R), 0 for none
+#define TRACE_FILE_RING 1024       // the ring holds at least this many requests while a trace file is written
+#define TRACE_FLUSH_MS 100         // how often the writer appends to the trace file and checks for a dump
+
+int trace_init(const char *path, int recorder, const char *dump_path);
+void trace_request(conn_t *conn);
+void trace_dump(void);
+int trace_server_timing(conn_t *conn, char *buf);
+
+#endif // __TRACE_H__
@@ -0,0 +1,207 @@
+#include <errno.h>
+#include <string.h>
+#include "uring.h"
+
+#ifdef HAVE_IO_URING
+
+#include <stdatomic.h>
+#include <unistd.h>
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+
+/**
+ * creates a ring and maps its queues
+ *
+ * @param ring the ring to initialize
+ * @param entries submission queue size; the kernel rounds it up to a power of two
+ * @return 0 on success, -1 if io_uring is unavailable (errno tells why)
+ */
+int uring_init(uring_t *ring, unsigned entries)
+{
+  struct io_uring_params p;
+  int saved;
+  memset(&p, 0, sizeof(p));
+  memset(ring, 0, sizeof(*ring));
+
+  ring->fd = syscall(__NR_io_uring_setup, entries, &p);
+  if (ring->fd < 0)
+    return -1;
+  ring->entries = p.sq_entries;
+
+  ring->sq_len = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+  ring->cq_len = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+  if (p.features & IORING_FEAT_SINGLE_MMAP)
+  {
+    // both queues live in one mapping
+    if (ring->cq_len > ring->sq_len)
+      ring->sq_len = ring->cq_len;
+    ring->cq_len = 0;
+  }
+
+  ring->sq_ptr = mmap(NULL, ring->sq_len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                      ring->fd, IORING_OFF_SQ_RING);
+  if (ring->sq_ptr == MAP_FAILED)
+    goto fail;
+  ring->cq_ptr = ring->sq_ptr;
+  if (ring->cq_len)
+  {
+    ring->cq_ptr = mmap(NULL, ring->cq_len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                        ring->fd, IORING_OFF_CQ_RING);
+    if (ring->cq_ptr == MAP_FAILED)
+      goto fail;
+  }
+  ring->sqes_len = p.sq_entries * sizeof(struct io_uring_sqe);
+  ring->sqes = mmap(NULL, ring->sqes_len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                    ring->fd, IORING_OFF_SQES);
+  if (ring->sqes == MAP_FAILED)
+    goto fail;
+
+  char *sq = (char *)ring->sq_ptr;
+  char *cq = (char *)ring->cq_ptr;
+  ring->sq_head = (unsigned *)(sq + p.sq_off.head);
+  ring->sq_tail = (unsigned *)(sq + p.sq_off.tail);
+  ring->sq_mask = (unsigned *)(sq + p.sq_off.ring_mask);
+  ring->sq_array = (unsigned *)(sq + p.sq_off.array);
+  ring->cq_head = (unsigned *)(cq + p.cq_off.head);
+  ring->cq_tail = (unsigned *)(cq + p.cq_off.tail);
+  ring->cq_mask = (unsigned *)(cq + p.cq_off.ring_mask);
+  ring->cqes = cq + p.cq_off.cqes;
+  return 0;
+
+fail:
+  saved = errno;
+  uring_exit(ring);
+  errno = saved;
+  return -1;
+}
+
+void uring_exit(uring_t *ring)
+{
+  if (ring->sqes && ring->sqes != MAP_FAILED)
+    munmap(ring->sqes, ring->sqes_len);
+  if (ring->cq_len && ring->cq_ptr && ring->cq_ptr != MAP_FAILED)
+    munmap(ring->cq_ptr, ring->cq_len);
+  if (ring->sq_ptr && ring->sq_ptr != MAP_FAILED)
+    munmap(ring->sq_ptr, ring->sq_len);
+  if (ring->fd >= 0)
+    close(ring->fd);
+  memset(ring, 0, sizeof(*ring));
+  ring->fd = -1;
+}
+
+/**
+ * queues a recv() on a socket; nothing reaches the kernel until
+ * uring_submit_and_wait()
+ *
+ * @param user_data returned with the completion
+ * @return 0 on success, -1 if the submission queue is full
+ */
+int uring_prep_recv(uring_t *ring, int fd, void *buf, size_t len, int flags, unsigned long long user_data)
+{
+  unsigned head = atomic_load_explicit((_Atomic unsigned *)ring->sq_head, memory_order_acquire);
+  unsigned tail = *ring->sq_tail + ring->queued;
+  if (tail - head >= ring->entries)
+    return -1;
+
+  unsigned index = tail & *ring->sq_mask;
+  struct io_uring_sqe *sqe = &((struct io_uring_sqe *)ring->sqes)[index];
+  memset(sqe, 0, sizeof(*sqe));
+  sqe->opcode = IORING_OP_RECV;
+  sqe->fd = fd;
+  sqe->addr = (unsigned long)buf;
+  sqe->len = len;
+  sqe->msg_flags = flags;
+  sqe->user_data = user_data;
+  ring->sq_array[index] = index;
+  ring->queued++;
+  return 0;
+}
+
+/**
+ * hands every queued entry to the kernel and waits for wait_nr completions,
+ * normally in one system call; if the call is interrupted or the kernel stops
+ * short, the entries it has not consumed yet are submitted again
+ *
+ * @return 0 on success, -1 on error or if the kernel takes none of the
+ *         remaining entries
+ */
+int uring_submit_and_wait(uring_t *ring, unsigned wait_nr)
+{
+  unsigned tail = *ring->sq_tail + ring->queued;
+  atomic_store_explicit((_Atomic unsigned *)ring->sq_tail, tail, memory_order_release);
+  ring->queued = 0;
+
+  while (1)
+  {
+    // the kernel advances sq_head past every entry it consumed, so the rest
+    // are still ours to submit
+    unsigned to_submit = tail - atomic_load_explicit((_Atomic unsigned *)ring->sq_head, memory_order_acquire);
+    int rc = syscall(__NR_io_uring_enter, ring->fd, to_submit, wait_nr, IORING_ENTER_GETEVENTS, NULL, 0);
+    if (rc < 0)
+    {
+      if (errno != EINTR)
+        return -1;
+      continue;
+    }
+    if ((unsigned)rc >= to_submit)
+      return 0;
+    if (rc == 0)
+    {
+      errno = EAGAIN;
+      return -1;
+    }
+  }
+}
+
+/**
+ * takes the next completion off the ring
+ *
+ * @param user_data receives the value given when the entry was queued
+ * @param res receives the result: what the system call would return, or -errno
+ * @return 0 if there was a completion, -1 if there is none yet
+ */
+int uring_reap(uring_t *ring, unsigned long long *user_data, int *res)
+{
+  unsigned head = *ring->cq_head;
+  if (head == atomic_load_explicit((_Atomic unsigned *)ring->cq_tail, memory_order_acquire))
+    return -1;
+
+  struct io_uring_cqe *cqe = &((struct io_uring_cqe *)ring->cqes)[head & *ring->cq_mask];
+  *user_data = cqe->user_data;
+  *res = cqe->res;
+  atomic_store_explicit((_Atomic unsigned *)ring->cq_head, head + 1, memory_order_release);
+  return 0;
+}
+
+#else // !HAVE_IO_URING
+
+int uring_init(uring_t *ring, unsigned entries)
+{
+  memset(ring, 0, sizeof(*ring));
+  ring->fd = -1;
+  errno = ENOSYS;
+  return -1;
+}
+
+void uring_exit(uring_t *ring)
+{
+}
+
+int uring_prep_recv(uring_t *ring, int fd, void *buf, size_t len, int flags, unsigned long long user_data)
+{
+  return -1;
+}
+
+int uring_submit_and_wait(uring_t *ring, unsigned wait_nr)
+{
+  errno = ENOSYS;
+  return -1;
+}
+
+int uring_reap(uring_t *ring, unsigned long long *user_data, int *res)
+{
+  return -1;
+}
+
+#endif // HAVE_IO_URING
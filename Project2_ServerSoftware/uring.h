@@ -0,0 +1,28 @@
+#ifndef __URING_H__
+#define __URING_H__
+
+#include <stddef.h>
+
+// a minimal io_uring, set up with raw system calls so no liburing is needed;
+// built only with HAVE_IO_URING, otherwise uring_init() always fails and
+// callers keep to plain system calls
+typedef struct
+{
+  int fd;
+  unsigned entries;
+  unsigned *sq_head, *sq_tail, *sq_mask, *sq_array;
+  unsigned *cq_head, *cq_tail, *cq_mask;
+  void *sqes;      // struct io_uring_sqe array
+  void *cqes;      // struct io_uring_cqe array
+  unsigned queued; // entries prepared since the last submit
+  void *sq_ptr, *cq_ptr;
+  size_t sq_len, cq_len, sqes_len;
+} uring_t;
+
+int uring_init(uring_t *ring, unsigned entries);
+void uring_exit(uring_t *ring);
+int uring_prep_recv(uring_t *ring, int fd, void *buf, size_t len, int flags, unsigned long long user_data);
+int uring_submit_and_wait(uring_t *ring, unsigned wait_nr);
+int uring_reap(uring_t *ring, unsigned long long *user_data, int *res);
+
+#endif // __URING_H__
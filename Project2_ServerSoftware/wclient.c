@@ -49,7 +49,8 @@ pthread_mutex_t print_mutex = PTHREAD_MUTEX_INITIALIZER;
 /**
  * sends an HTTP request for the specified file to the connected server
  * formulates a simple HTTP GET request including the hostname and sends it through
- * the provided file descriptor
+ * the provided file descriptor; the request asks the server to close the connection
+ * afterwards, since client_read() reads the body until end of file
  *
  * @param fd the file descriptor for the client connection to the server
  * @param filename the URI/path of the file to request from the server
@@ -63,7 +64,7 @@ void client_send(int fd, char *filename)
 
   /* form and send the HTTP request */
   sprintf(buf, "GET %s HTTP/1.1\n", filename);
-  sprintf(buf, "%shost: %s\n\r\n", buf, hostname);
+  sprintf(buf, "%shost: %s\nConnection: close\n\r\n", buf, hostname);
   write_or_die(fd, buf, strlen(buf));
 }
 
@@ -1,8 +1,22 @@
+#define _GNU_SOURCE
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <limits.h>
 #include <pthread.h>
 #include "request.h"
+#include "reactor.h"
+#include "cgi_pool.h"
+#include "file_cache.h"
+#include "sched.h"
+#include "sqldb.h"
+#include "predict.h"
+#include "codel.h"
+#include "mpmc.h"
+#include "pool.h"
+#include "access_log.h"
+#include "stats.h"
+#include "trace.h"
 #include "io_helper.h"
 
 char default_root[] = ".";
@@ -10,234 +24,878 @@ char default_root[] = ".";
 // default values
 #define DEFAULT_THREADS 1
 #define DEFAULT_BUFFER_SIZE 1
-#define MAX_THREADS 100
-#define MAX_BUFFER_SIZE 100
 
-// scheduling algorithms
-#define FIFO 0
-#define SFF 1
+// queue layouts
+#define QUEUE_SHARED 0 // one queue for all workers
+#define QUEUE_WORKER 1 // one run queue per worker, idle workers steal
 
-// request in the buffer
+// server modes
+#define MODE_SINGLE 0  // one listener and event loop
+#define MODE_PERCORE 1 // one pinned listener, event loop, queue and pool per CPU
+
+// overload policies
+#define OVERLOAD_BLOCK 0  // a full queue stops the reactor until a worker takes a request
+#define OVERLOAD_REJECT 1 // a full queue answers new requests with 503 at once
+#define OVERLOAD_CODEL 2  // as reject, and requests that queued too long under sustained load are shed
+
+#define RETRY_AFTER_SECONDS 1 // Retry-After sent with a shed request
+
+// bulkheads: once -t, -b or -s names a lane, static and dynamic requests
+// (as request_parse_uri() tells them apart) wait in separate queues with
+// their own workers, so slow CGI programs cannot hold up static files
+#define LANE_STATIC 0
+#define LANE_DYNAMIC 1
+#define LANES 2
+
+// a request queue with its own policy and workers; its policy does its own
+// locking, so threads park on futexes only while it is empty (workers) or
+// full (the reactor)
+typedef struct
+{
+  char name[32];             // used in log lines
+  int cpu;                   // CPU the lane's workers run on, -1 if not pinned
+  const sched_ops_t *policy; // -s
+  int min_threads;           // workers that always run (-t)
+  int max_threads;           // workers the elastic pool may grow to (-t min:max)
+  int buffers;               // -b
+  sched_t queue;             // only used with -q shared
+  waitq_t not_empty;
+  waitq_t not_full;
+  codel_t codel;
+  pool_t pool;
+} lane_t;
+
+// a server instance with its own listener, event loop, lanes and workers;
+// -m percore runs one per CPU, so nothing on the request path is shared
 typedef struct
 {
-  int fd;                  // client file descriptor
-  struct sockaddr_in addr; // client address
-  int filesize;            // SFF scheduling
-} request_t;
+  int cpu; // CPU the instance's threads run on, -1 if not pinned
+  int listen_fd;
+  reactor_t reactor;
+  lane_t lanes[LANES];
+} core_t;
 
 // global variables
-int num_threads = DEFAULT_THREADS;
-int buffer_size = DEFAULT_BUFFER_SIZE;
-int scheduling_alg = FIFO;
-int buffer_count = 0;
-int buffer_head = 0;
-int buffer_tail = 0;
-request_t *request_buffer;
-
-// synchronization variables
-pthread_mutex_t buffer_mutex = PTHREAD_MUTEX_INITIALIZER;
-pthread_cond_t buffer_not_full = PTHREAD_COND_INITIALIZER;
-pthread_cond_t buffer_not_empty = PTHREAD_COND_INITIALIZER;
+lane_t lane_config[LANES]; // the settings every instance copies into its lanes
+int num_lanes = 1;         // 1 while every request shares lanes[0]
+
+int server_mode = MODE_SINGLE;
+core_t *cores;
+int num_cores = 1; // with -m percore, one per CPU unless given as percore:N
+
+// -t, -b and -s values per lane, before they are checked
+char *lane_threads[LANES];
+char *lane_buffers[LANES];
+char *lane_policies[LANES];
+
+// a worker's own run queue (-q worker); the scheduling policy applies per queue
+typedef struct
+{
+  sched_t sched;
+  waitq_t not_empty; // the owning worker parks here
+} run_queue_t;
+
+// admission control (-o and -T)
+int overload_policy = OVERLOAD_BLOCK;
+int codel_target_ms = DEFAULT_CODEL_TARGET_MS; // each lane runs its own CoDel
+
+int queue_mode = QUEUE_SHARED;
+run_queue_t *run_queues;
+int num_run_queues; // one per worker of the only lane
+int next_queue = 0;      // round-robin position, only used by the reactor
+waitq_t queues_not_full; // the reactor parks here while every run queue is full
+
+// access log (-l and -L)
+char *access_log_path = "-";
+int access_log_sample = DEFAULT_ACCESS_LOG_SAMPLE;
+
+// request tracing (-x and -R); SIGUSR1 dumps the flight recorder
+char *trace_path = NULL;
+int trace_recorder = DEFAULT_TRACE_RECORDER;
+char trace_dump_path[4096];
+
+/**
+ * tells whether a request path ends with the given name
+ */
+static int path_ends_with(const http_request_t *req, const char *name)
+{
+  size_t len = strlen(name);
+  return req->path.len >= len && memcmp(req->path.ptr + req->path.len - len, name, len) == 0;
+}
+
+/**
+ * decodes the SQL command of a sql.cgi or /sql request
+ *
+ * @param req the parsed HTTP request
+ * @param sql buffer of MAX_QUERY_LEN bytes receiving the command
+ * @return 1 if the request carries a SQL command, 0 otherwise
+ */
+static int request_sql(const http_request_t *req, char *sql)
+{
+  char query[MAX_QUERY_LEN];
+
+  if (req->query.len == 0 || !(path_ends_with(req, "sql.cgi") ||
+                               (req->path.len == 4 && memcmp(req->path.ptr, "/sql", 4) == 0)))
+    return 0;
+  http_slice_copy(&req->query, query, sizeof(query));
+  sql_url_decode(query, sql, MAX_QUERY_LEN);
+  return 1;
+}
 
 /**
  * Estimates the file size for Shortest File First (SFF) scheduling
  * parses the HTTP request to determine the requested URI and attempts to estimate
  * the size of the resource. For CGI scripts with a 'spin' parameter, it uses the parameter
- * value as a proxy for file size
+ * value as a proxy for file size. For SQL queries (sql.cgi or /sql), it uses the
+ * blocks the query is expected to read and write, so point lookups and inserts
+ * rank ahead of scans of large tables
  *
- * @param fd the client file descriptor to read the HTTP request from
+ * the request has already been parsed by the reactor, so no socket I/O is needed
+ *
+ * @param conn the client connection holding the parsed HTTP request
  * @return estimated size of the requested resource in bytes
  */
-int estimate_filesize(int fd)
+int estimate_filesize(conn_t *conn)
 {
-  // read the HTTP request to estimate file size
-  char buffer[8192];
-  int n = recv(fd, buffer, sizeof(buffer) - 1, MSG_PEEK);
-  if (n <= 0)
-    return 0;
+  const http_request_t *req = &conn->req;
 
-  buffer[n] = '\0';
+  // if it's a CGI script with spin parameter, use that as a proxy for file size
+  if (req->query.len > 0 && path_ends_with(req, "spin.cgi"))
+  {
+    int spin_time = atoi(req->query.ptr);
+    return spin_time * 1000;
+  }
 
-  char *uri_start = strstr(buffer, "GET ");
-  if (!uri_start)
-    return n;
+  char sql[MAX_QUERY_LEN];
+  if (request_sql(req, sql))
+  {
+    // a full scan of a table past 1 GB would overflow an int; clamping keeps
+    // the largest scans last
+    long long bytes = (long long)sql_estimate_cost(sql) * BLOCK_SIZE;
+    return bytes > INT_MAX ? INT_MAX : (int)bytes;
+  }
 
-  uri_start += 4; // skip "GET "
-  char *uri_end = strchr(uri_start, ' ');
-  if (!uri_end)
-    return n;
+  return conn->header_len;
+}
 
-  int uri_len = uri_end - uri_start;
-  char uri[1024];
-  if (uri_len >= sizeof(uri))
-    uri_len = sizeof(uri) - 1;
-  strncpy(uri, uri_start, uri_len);
-  uri[uri_len] = '\0';
+/**
+ * names the class of a request for Shortest Job First (SJF) scheduling
+ * requests of one class are expected to take about as long as each other: a
+ * static file is its own class, a SQL query is classed by statement type and
+ * table, and any other dynamic request by its path and full query string
+ *
+ * @param conn the client connection holding the parsed HTTP request
+ * @return hash identifying the class, never 0
+ */
+unsigned long long request_class(conn_t *conn)
+{
+  const http_request_t *req = &conn->req;
+  unsigned long long job_class = predict_hash(0, req->path.ptr, req->path.len);
+  char sql[MAX_QUERY_LEN];
 
-  // if it's a CGI script with spin parameter, use that as a proxy for file size
-  if (strstr(uri, "spin.cgi?"))
+  if (request_sql(req, sql))
   {
-    char *param = strchr(uri, '?');
-    if (param)
+    int command_type = 0;
+    char table_name[32] = "";
+    sql_command_table(sql, &command_type, table_name);
+    job_class = predict_hash(job_class, (const char *)&command_type, sizeof(command_type));
+    return predict_hash(job_class, table_name, strlen(table_name));
+  }
+  if (http_slice_contains(&req->path, "cgi"))
+  {
+    job_class = predict_hash(job_class, "?", 1);
+    return predict_hash(job_class, req->query.ptr, req->query.len);
+  }
+  return job_class;
+}
+
+/**
+ * sets the deadline for Earliest Deadline First (EDF) scheduling
+ * a client with a latency budget sends it as "X-Deadline-Ms: <ms>", counted
+ * from the time the request was queued; the request is dropped with 503 if
+ * no worker has picked it up by then. Other requests, and those whose header
+ * is not a whole number of milliseconds from 1 to SCHED_MAX_DEADLINE_MS, are
+ * due sched_default_deadline_ms after they were queued and never dropped
+ *
+ * @param conn the client connection holding the parsed HTTP request
+ * @param request the request, with enqueued_us set
+ */
+void request_deadline(conn_t *conn, request_t *request)
+{
+  const http_slice_t *value = http_get_header(&conn->req, "X-Deadline-Ms");
+  char budget[32];
+
+  if (value && http_slice_copy(value, budget, sizeof(budget)) > 0)
+  {
+    char *end;
+    errno = 0;
+    long long ms = strtoll(budget, &end, 10);
+    if (errno == 0 && end != budget && *end == '\0' && ms > 0 && ms <= SCHED_MAX_DEADLINE_MS)
     {
-      int spin_time = atoi(param + 1);
-      return spin_time * 1000;
+      request->deadline_us = request->enqueued_us + ms * 1000;
+      request->expires = 1;
+      return;
     }
   }
+  request->deadline_us = request->enqueued_us + sched_default_deadline_ms * 1000LL;
+  request->expires = 0;
+}
 
-  return n;
+/**
+ * names the tenant a request is billed to for Deficit Round Robin (DRR)
+ * scheduling: the value of its X-Api-Key header if it has one, its client
+ * address otherwise, so clients sharing a key share one turn
+ *
+ * @param conn the client connection holding the parsed HTTP request
+ * @return hash identifying the tenant
+ */
+unsigned long long request_tenant(conn_t *conn)
+{
+  const http_slice_t *key = http_get_header(&conn->req, "X-Api-Key");
+
+  if (key && key->len > 0)
+    return predict_hash(predict_hash(0, "key:", 4), key->ptr, key->len);
+  return predict_hash(predict_hash(0, "addr:", 5), (const char *)&conn->addr.sin_addr,
+                      sizeof(conn->addr.sin_addr));
 }
 
 /**
- * adds a client request to the request buffer
- * if the buffer is full, the function will block until space becomes available
- * the file size of the requested resource is estimated for potential SFF scheduling
+ * initializes the per-worker run queues, splitting the -b buffers between them
  *
- * @param fd the client socket file descriptor
- * @param addr the client's address information
+ * @return 0 on success, -1 if memory could not be allocated
  */
-void add_request(int fd, struct sockaddr_in addr)
+int init_run_queues()
 {
-  pthread_mutex_lock(&buffer_mutex);
+  num_run_queues = lane_config[0].min_threads;
+  int capacity = (lane_config[0].buffers + num_run_queues - 1) / num_run_queues;
 
-  while (buffer_count == buffer_size)
+  run_queues = (run_queue_t *)calloc(num_run_queues, sizeof(run_queue_t));
+  if (!run_queues)
+    return -1;
+  for (int i = 0; i < num_run_queues; i++)
   {
-    pthread_cond_wait(&buffer_not_full, &buffer_mutex);
+    if (sched_init(&run_queues[i].sched, lane_config[0].policy, capacity) < 0)
+      return -1;
   }
-
-  request_t request;
-  request.fd = fd;
-  request.addr = addr;
-  request.filesize = estimate_filesize(fd);
-
-  // add new request to the buffer
-  request_buffer[buffer_tail] = request;
-  buffer_tail = (buffer_tail + 1) % buffer_size;
-  buffer_count++;
-
-  // signal that buffer is not empty
-  pthread_cond_broadcast(&buffer_not_empty);
-  pthread_mutex_unlock(&buffer_mutex);
+  return 0;
 }
 
 /**
- * retrieves request from the buffer using First-In-First-Out (FIFO) scheduling policy
- * returns the request at the head of the buffer (oldest request)
+ * wakes the owner of a run queue that just received a request, or, if the
+ * owner is busy, one parked worker that can steal the request instead
  *
- * @return the request at the head of the buffer
+ * @param owner index of the run queue that received the request
  */
-request_t get_fifo_request()
+void wake_worker(int owner)
 {
-  request_t request = request_buffer[buffer_head];
-  buffer_head = (buffer_head + 1) % buffer_size;
-  return request;
+  for (int i = 0; i < num_run_queues; i++)
+  {
+    waitq_t *q = &run_queues[(owner + i) % num_run_queues].not_empty;
+    if (waitq_has_waiters(q))
+    {
+      waitq_wake_one(q);
+      return;
+    }
+  }
 }
 
 /**
- * retrieves request from the buffer using Shortest File First (SFF) scheduling policy
- * scans the entire buffer to find the request with the smallest estimated file size
- * removes the selected request from the buffer and adjusts the buffer
+ * offers a request to the run queues round-robin, starting after the queue
+ * that received the previous request
  *
- * @return the request with the smallest estimated file size
+ * @return index of the queue that took the request, or -1 if all are full
  */
-request_t get_sff_request()
+int offer_request(request_t *request)
 {
-  // find the smallest file
-  int smallest_idx = buffer_head;
-  int smallest_size = request_buffer[smallest_idx].filesize;
+  for (int i = 0; i < num_run_queues; i++)
+  {
+    int q = next_queue;
+    next_queue = (next_queue + 1) % num_run_queues;
+    if (sched_enqueue(&run_queues[q].sched, request) == 0)
+      return q;
+  }
+  return -1;
+}
 
-  for (int i = 0; i < buffer_count; i++)
+/**
+ * adds a request to a worker's run queue (-q worker)
+ * requests are spread round-robin; if every queue is full, the reactor parks
+ * until a worker takes a request, unless the overload policy sheds instead
+ *
+ * @param request the request with its scheduling estimate
+ * @return 0 on success, -1 if every queue is full and the request must be shed
+ */
+int add_worker_request(request_t *request)
+{
+  int q;
+  while ((q = offer_request(request)) < 0)
   {
-    int idx = (buffer_head + i) % buffer_size;
-    if (request_buffer[idx].filesize < smallest_size)
+    if (overload_policy != OVERLOAD_BLOCK)
+      return -1;
+    uint32_t epoch = waitq_prepare(&queues_not_full);
+    if ((q = offer_request(request)) >= 0)
     {
-      smallest_idx = idx;
-      smallest_size = request_buffer[idx].filesize;
+      waitq_cancel(&queues_not_full);
+      break;
     }
+    waitq_wait(&queues_not_full, epoch);
   }
+  wake_worker(q);
+  return 0;
+}
 
-  // save the request to return
-  request_t request = request_buffer[smallest_idx];
-
-  if (smallest_idx != buffer_head)
+/**
+ * takes a request from the worker's own run queue or, if that is empty,
+ * steals one from the next busy peer
+ *
+ * @return 0 on success, -1 if every run queue is empty
+ */
+int take_request(int self, request_t *request)
+{
+  for (int i = 0; i < num_run_queues; i++)
   {
-    // swap with head
-    request_buffer[smallest_idx] = request_buffer[buffer_head];
+    if (sched_dequeue(&run_queues[(self + i) % num_run_queues].sched, request) == 0)
+      return 0;
   }
+  return -1;
+}
 
-  // advance head
-  buffer_head = (buffer_head + 1) % buffer_size;
+/**
+ * gets the next request for a worker from its own run queue (-q worker)
+ * if no queue has work, the worker parks on its own queue until
+ * add_worker_request() wakes it
+ *
+ * @param self index of the calling worker
+ * @return the next request to be processed
+ */
+request_t get_worker_request(int self)
+{
+  request_t request;
+  waitq_t *not_empty = &run_queues[self].not_empty;
 
+  while (take_request(self, &request) < 0)
+  {
+    uint32_t epoch = waitq_prepare(not_empty);
+    if (take_request(self, &request) == 0)
+    {
+      waitq_cancel(not_empty);
+      break;
+    }
+    waitq_wait(not_empty, epoch);
+  }
+  waitq_wake_one(&queues_not_full);
   return request;
 }
 
 /**
- * gets the next request from the buffer based on the scheduling algorithm
- * if the buffer is empty, the function will block until a request is available
- * delegates to either get_fifo_request() or get_sff_request() based on the scheduling_alg setting
+ * records a request whose response is complete in the trace and the access
+ * log, then hands its connection back to the reactor or closes it
+ *
+ * @param conn the client connection
+ * @param wait_us time the request spent in the queue
+ * @param service_us time a worker spent on the request
+ */
+void finish_request(conn_t *conn, long long wait_us, long long service_us)
+{
+  trace_request(conn);
+  access_log_request(conn, wait_us, service_us);
+  conn_done(conn);
+}
+
+/**
+ * answers a request with 503 and Retry-After instead of serving it, so that
+ * the client backs off rather than waiting in an overloaded queue
+ *
+ * @param conn the client connection with its buffered request
+ * @param reason why the request was shed
+ */
+void shed_request(conn_t *conn, char *reason)
+{
+  request_reject(conn, "overload", reason, RETRY_AFTER_SECONDS);
+  stats_count(STATS_SHED, 1);
+  finish_request(conn, now_usec() - conn->queued_us, 0);
+}
+
+/**
+ * picks the lane a request waits in, among those of the instance whose event
+ * loop accepted it: with bulkheads, static and dynamic requests go to their
+ * own lanes, otherwise everything shares the first
+ */
+lane_t *request_lane(conn_t *conn)
+{
+  core_t *core = (core_t *)conn->reactor->arg;
+  if (num_lanes == 1)
+    return &core->lanes[0];
+  return &core->lanes[request_is_static(conn) ? LANE_STATIC : LANE_DYNAMIC];
+}
+
+/**
+ * adds a client request to the request queue of its lane
+ * if the queue is full, the function will block until space becomes available,
+ * or, with -o reject or -o codel, answer the request with 503 at once
+ * the file size of the requested resource is estimated for potential SFF scheduling
+ *
+ * called by the reactor once the request line and headers have fully arrived
  *
- * @return the next request to be processed according to the current scheduling policy
+ * @param conn the client connection with its buffered request
  */
-request_t get_request()
+void add_request(conn_t *conn)
 {
-  pthread_mutex_lock(&buffer_mutex);
+  lane_t *lane = request_lane(conn);
+  const sched_ops_t *sched_policy = lane->policy;
+  request_t request;
+  request.conn = conn;
+  request.filesize = 0;
+  request.job_class = 0;
+  request.predicted_us = 0;
+  request.enqueued_us = now_usec();
+  request.deadline_us = 0;
+  request.expires = 0;
+  request.tenant = 0;
+  if (sched_policy == &sched_sff_ops || sched_policy == &sched_sff_aging_ops ||
+      sched_policy == &sched_drr_ops)
+  {
+    request.filesize = estimate_filesize(conn);
+  }
+  if (sched_policy == &sched_sjf_ops)
+  {
+    request.job_class = request_class(conn);
+    request.predicted_us = predict_service_time(request.job_class);
+  }
+  if (sched_policy == &sched_edf_ops)
+  {
+    request_deadline(conn, &request);
+  }
+  if (sched_policy == &sched_drr_ops)
+  {
+    request.tenant = request_tenant(conn);
+  }
+
+  conn->queued_us = request.enqueued_us;
 
-  // wait if buffer is empty
-  while (buffer_count == 0)
+  if (queue_mode == QUEUE_WORKER)
   {
-    pthread_cond_wait(&buffer_not_empty, &buffer_mutex);
+    if (add_worker_request(&request) < 0)
+      shed_request(conn, "request queue is full");
+    return;
   }
 
-  request_t request;
+  while (sched_enqueue(&lane->queue, &request) < 0)
+  {
+    if (overload_policy != OVERLOAD_BLOCK)
+    {
+      shed_request(conn, "request queue is full");
+      return;
+    }
+    uint32_t epoch = waitq_prepare(&lane->not_full);
+    if (sched_enqueue(&lane->queue, &request) == 0)
+    {
+      waitq_cancel(&lane->not_full);
+      break;
+    }
+    waitq_wait(&lane->not_full, epoch);
+  }
+  waitq_wake_one(&lane->not_empty);
+}
 
-  // choose scheduling algorithm
-  if (scheduling_alg == FIFO)
+/**
+ * gets the next request based on the scheduling policy (-s)
+ * if the queue is empty, the function will block until a request is available,
+ * or, in an elastic pool, until the worker has been idle long enough to retire;
+ * the policy decides which waiting request comes next, or, when every worker
+ * has its own run queue, get_worker_request() does
+ *
+ * @param lane the lane of the calling worker
+ * @param worker index of the calling worker
+ * @param request receives the next request according to the current scheduling policy
+ * @return 0 on success, -1 if no request came within pool_idle_ms()
+ */
+int get_request(lane_t *lane, int worker, request_t *request)
+{
+  if (queue_mode == QUEUE_WORKER)
   {
-    request = get_fifo_request();
+    *request = get_worker_request(worker);
+    return 0;
   }
-  else
+
+  int idle_ms = pool_idle_ms(&lane->pool);
+  while (sched_dequeue(&lane->queue, request) < 0)
   {
-    request = get_sff_request();
+    uint32_t epoch = waitq_prepare(&lane->not_empty);
+    if (sched_dequeue(&lane->queue, request) == 0)
+    {
+      waitq_cancel(&lane->not_empty);
+      break;
+    }
+    if (idle_ms == 0)
+    {
+      waitq_wait(&lane->not_empty, epoch);
+    }
+    else if (waitq_wait_timeout(&lane->not_empty, epoch, idle_ms) < 0)
+    {
+      // a request that arrived as the wait timed out must still be served
+      if (sched_dequeue(&lane->queue, request) < 0)
+        return -1;
+      break;
+    }
   }
+  waitq_wake_one(&lane->not_full);
+  return 0;
+}
+
+/**
+ * tells the elastic pool of a lane how many requests wait in its queue
+ */
+int queue_depth(pool_t *p)
+{
+  lane_t *lane = (lane_t *)p->arg;
+  sched_stats_t stats;
+  sched_stats(&lane->queue, &stats);
+  return stats.depth;
+}
+
+/**
+ * writes the flight recorder to the dump file (SIGUSR1)
+ */
+void dump_trace(int sig)
+{
+  trace_dump();
+}
 
-  buffer_count--;
+/**
+ * turns the access log off or back on (SIGUSR2)
+ */
+void toggle_access_log(int sig)
+{
+  access_log_toggle();
+}
 
-  pthread_cond_signal(&buffer_not_full);
-  pthread_mutex_unlock(&buffer_mutex);
+/**
+ * reports every lane of every instance for /__stats; with per-worker run
+ * queues, the only lane's queue is the sum of the run queues
+ *
+ * @param out receives at most max lanes
+ * @param max room in out
+ * @return the number of lanes
+ */
+int stats_lanes(stats_lane_t *out, int max)
+{
+  int n = 0;
+  for (int i = 0; i < num_cores; i++)
+  {
+    for (int j = 0; j < num_lanes; j++, n++)
+    {
+      if (n >= max)
+        continue;
+      lane_t *lane = &cores[i].lanes[j];
+      stats_lane_t *report = &out[n];
+      sched_stats_t stats;
+      memset(&stats, 0, sizeof(stats));
+      if (queue_mode == QUEUE_WORKER)
+      {
+        for (int k = 0; k < num_run_queues; k++)
+        {
+          sched_stats_t queue;
+          sched_stats(&run_queues[k].sched, &queue);
+          stats.enqueued += queue.enqueued;
+          stats.dequeued += queue.dequeued;
+          stats.depth += queue.depth;
+          for (int c = 0; c < SCHED_CLASSES; c++)
+          {
+            stats.classes[c].enqueued += queue.classes[c].enqueued;
+            stats.classes[c].dequeued += queue.classes[c].dequeued;
+            stats.classes[c].wait_total_us += queue.classes[c].wait_total_us;
+            if (queue.classes[c].wait_max_us > stats.classes[c].wait_max_us)
+              stats.classes[c].wait_max_us = queue.classes[c].wait_max_us;
+          }
+        }
+      }
+      else
+      {
+        sched_stats(&lane->queue, &stats);
+      }
+      pool_stats_t pool;
+      pool_stats(&lane->pool, &pool);
 
-  return request;
+      snprintf(report->name, sizeof(report->name), "%s", lane->name);
+      report->policy = lane->policy->name;
+      report->depth = stats.depth;
+      report->enqueued = stats.enqueued;
+      report->dequeued = stats.dequeued;
+      memcpy(report->classes, stats.classes, sizeof(report->classes));
+      pthread_mutex_lock(&lane->codel.mutex);
+      report->shed = lane->codel.shed;
+      pthread_mutex_unlock(&lane->codel.mutex);
+      report->workers = pool.threads;
+      report->busy = pool.busy;
+      report->peak = pool.peak;
+      report->grown = pool.grown;
+      report->shrunk = pool.shrunk;
+    }
+  }
+  return n;
+}
+
+/**
+ * keeps the calling thread on one CPU, so its instance's queues and
+ * connections stay in that CPU's caches
+ *
+ * @param cpu the CPU, or -1 to leave the thread unpinned
+ */
+void pin_thread(int cpu)
+{
+  if (cpu < 0)
+    return;
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  CPU_SET(cpu, &set);
+  pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
 }
 
 /**
  * worker thread function that continuously processes requests from the request buffer
  * each thread calls get_request() to obtain the next request to handle,
- * processes the request with request_handle(), and then closes the client
+ * processes the request with request_handle(), and then either hands a persistent
+ * connection back to the reactor or closes it; in an elastic pool, a worker
+ * above the minimum that stays idle exits
  *
- * @param arg thread argument (unused)
- * @return NULL (thread runs until program termination)
+ * @param pool the pool of the worker's lane
+ * @param worker index of the worker
  */
-void *worker_thread(void *arg)
+void worker_thread(pool_t *pool, int worker)
 {
+  lane_t *lane = (lane_t *)pool->arg;
+  pin_thread(lane->cpu);
   while (1)
   {
-    request_t request = get_request();
-    request_handle(request.fd);
-    close_or_die(request.fd);
+    request_t request;
+    if (get_request(lane, worker, &request) < 0)
+    {
+      if (pool_retire(pool))
+        return;
+      continue;
+    }
+    pool_begin(pool);
+    long long start = now_usec();
+    request.conn->trace.dequeued_us = start;
+    if (request.expires && start > request.deadline_us)
+    {
+      // too late to be of use to the client; do not spend the worker on it
+      request_reject(request.conn, "X-Deadline-Ms", "request deadline passed before it was served", 0);
+      stats_count(STATS_EXPIRED, 1);
+      finish_request(request.conn, start - request.enqueued_us, 0);
+      pool_end(pool);
+      continue;
+    }
+    if (overload_policy == OVERLOAD_CODEL && codel_should_drop(&lane->codel, start - request.enqueued_us, start))
+    {
+      shed_request(request.conn, "request queued too long");
+      pool_end(pool);
+      continue;
+    }
+    request.conn->trace.handler_us = now_usec();
+    request_handle(request.conn);
+    long long service = now_usec() - start;
+    if (request.job_class != 0)
+      predict_record(request.job_class, service);
+    int kind = request_kind(request.conn);
+    if (kind >= 0)
+      stats_record(kind, start - request.enqueued_us, service);
+    stats_count(STATS_REQUESTS, 1);
+    finish_request(request.conn, start - request.enqueued_us, service);
+    pool_end(pool);
   }
+}
+
+/**
+ * splits the value of -t, -b or -s between the lanes: a plain value applies
+ * to every lane, and a list such as static=4,dynamic=16 sets each named lane
+ * and turns on bulkheads
+ *
+ * @param arg the option's value; the list is split in place
+ * @param values receives the value for each lane it names
+ * @param option the option letter, for error messages
+ */
+void parse_lanes(char *arg, char **values, int option)
+{
+  if (!strchr(arg, '='))
+  {
+    for (int i = 0; i < LANES; i++)
+      values[i] = arg;
+    return;
+  }
+
+  num_lanes = LANES;
+  for (char *item = strtok(arg, ","); item; item = strtok(NULL, ","))
+  {
+    char *value = strchr(item, '=');
+    if (value)
+      *value++ = '\0';
+    if (value && strcasecmp(item, "static") == 0)
+    {
+      values[LANE_STATIC] = value;
+    }
+    else if (value && strcasecmp(item, "dynamic") == 0)
+    {
+      values[LANE_DYNAMIC] = value;
+    }
+    else
+    {
+      fprintf(stderr, "Invalid lane in -%c. Must be static=value or dynamic=value\n", option);
+      exit(1);
+    }
+  }
+}
+
+/**
+ * checks the -t, -b and -s values of every lane in use and sets the lane up;
+ * lanes an option did not name keep the defaults
+ */
+void init_lanes()
+{
+  strcpy(lane_config[LANE_STATIC].name, num_lanes == 1 ? "all" : "static");
+  strcpy(lane_config[LANE_DYNAMIC].name, "dynamic");
+
+  for (int i = 0; i < num_lanes; i++)
+  {
+    lane_t *lane = &lane_config[i];
+
+    lane->min_threads = lane->max_threads = DEFAULT_THREADS;
+    if (lane_threads[i])
+    {
+      lane->min_threads = atoi(lane_threads[i]);
+      char *max = strchr(lane_threads[i], ':');
+      lane->max_threads = max ? atoi(max + 1) : lane->min_threads;
+    }
+    if (lane->min_threads <= 0)
+    {
+      fprintf(stderr, "Number of threads must be positive\n");
+      exit(1);
+    }
+    if (lane->max_threads < lane->min_threads)
+    {
+      fprintf(stderr, "Maximum number of threads must not be below the minimum\n");
+      exit(1);
+    }
+
+    lane->buffers = lane_buffers[i] ? atoi(lane_buffers[i]) : DEFAULT_BUFFER_SIZE;
+    if (lane->buffers <= 0)
+    {
+      fprintf(stderr, "Buffer size must be positive\n");
+      exit(1);
+    }
+
+    lane->policy = lane_policies[i] ? sched_find(lane_policies[i]) : &sched_fifo_ops;
+    if (!lane->policy)
+    {
+      fprintf(stderr, "Invalid scheduling algorithm. Must be FIFO, SFF, SFF-AGING, SJF, EDF or DRR\n");
+      exit(1);
+    }
+  }
+}
+
+/**
+ * sets up the server instances: each gets its own listener, event loop and
+ * lanes copied from lane_config; with -m percore each also gets a CPU, taken
+ * in turn from the CPUs the server may run on, and an SO_REUSEPORT listener,
+ * so the kernel spreads connections across the instances
+ *
+ * @param port port number to listen on
+ * @return 0 on success, -1 if a listener or queue could not be created
+ */
+int init_cores(int port)
+{
+  cpu_set_t allowed;
+  int cpus[CPU_SETSIZE];
+  int num_cpus = 0;
+
+  if (server_mode == MODE_PERCORE && sched_getaffinity(0, sizeof(allowed), &allowed) == 0)
+  {
+    for (int cpu = 0; cpu < CPU_SETSIZE; cpu++)
+    {
+      if (CPU_ISSET(cpu, &allowed))
+        cpus[num_cpus++] = cpu;
+    }
+  }
+  if (num_cores == 0)
+    num_cores = num_cpus > 0 ? num_cpus : 1;
+
+  cores = (core_t *)calloc(num_cores, sizeof(core_t));
+  if (!cores)
+    return -1;
+  for (int i = 0; i < num_cores; i++)
+  {
+    core_t *core = &cores[i];
+    core->cpu = num_cpus > 0 ? cpus[i % num_cpus] : -1;
+    core->listen_fd = server_mode == MODE_PERCORE ? open_listen_fd_reuseport(port) : open_listen_fd(port);
+    if (core->listen_fd < 0)
+      return -1;
+
+    for (int j = 0; j < num_lanes; j++)
+    {
+      lane_t *lane = &core->lanes[j];
+      *lane = lane_config[j];
+      if (num_cores > 1)
+        snprintf(lane->name, sizeof(lane->name), "%d/%.16s", i, lane_config[j].name);
+      lane->cpu = core->cpu;
+      waitq_init(&lane->not_empty);
+      waitq_init(&lane->not_full);
+      codel_init(&lane->codel, codel_target_ms, DEFAULT_CODEL_INTERVAL_MS);
+      if (queue_mode == QUEUE_SHARED && sched_init(&lane->queue, lane->policy, lane->buffers) < 0)
+        return -1;
+    }
+
+    reactor_init(&core->reactor, core->listen_fd, add_request);
+    core->reactor.arg = core;
+  }
+  return 0;
+}
+
+/**
+ * runs the event loop of a server instance on its CPU
+ *
+ * @param arg the instance
+ * @return NULL (the loop runs until program termination)
+ */
+void *core_thread(void *arg)
+{
+  core_t *core = (core_t *)arg;
+  pin_thread(core->cpu);
+  reactor_run(&core->reactor);
   return NULL;
 }
 
 /**
  * main function that initializes and starts the web server
  * command-line arguments, sets up the request buffer, creates worker threads
- * and enters the main accept loop to receive client connections
+ * and runs the epoll reactor that accepts client connections and buffers their
+ * requests until they are ready for a worker
  *
  * command-line options
  * -d <basedir>  : Set the root directory for the server
  * -p <portnum>  : Set the port number to listen on
- * -t <threads>  : Set the number of worker threads
+ * -t <threads>  : Set the number of worker threads, or min:max for an elastic pool
  * -b <buffers>  : Set the size of the request buffer
- * -s <schedalg> : Set the scheduling algorithm (FIFO or SFF)
+ * -s <schedalg> : Set the scheduling algorithm (FIFO, SFF, SFF-AGING, SJF, EDF or DRR)
+ *                 -t, -b and -s also take static=value,dynamic=value for separate lanes
+ * -a <rate>     : Set the estimated bytes SFF-AGING forgives a request per second it waits
+ * -w <ms>       : Set the longest SFF-AGING lets a request wait before serving it next (0 for no limit)
+ * -e <ms>       : Set the EDF deadline of requests without an X-Deadline-Ms header
+ * -o <policy>   : Set the overload policy (block, reject, or codel to also shed requests that queued too long)
+ * -T <ms>       : Set the queue wait CoDel aims for
+ * -k <seconds>  : Set the keep-alive idle timeout (0 disables keep-alive)
+ * -r <requests> : Set the maximum number of requests per connection
+ * -H <seconds>  : Set the time a client has to send its request line and headers (0 for no limit)
+ * -c <workers>  : Set the number of pooled worker processes per CGI program (0 disables the pool)
+ * -C <requests> : Set the number of requests a pooled CGI worker serves before it is replaced
+ * -f <entries>  : Set the number of static files kept in the file cache (0 disables the cache)
+ * -q <queues>   : Set the queue layout (shared, or worker for per-worker run queues with stealing)
+ * -m <mode>     : Set the server mode (single, or percore[:N] for one pinned instance per CPU)
+ * -I <backend>  : Set how ready sockets are read (syscall, or uring to batch them through io_uring)
+ * -l <file>     : Set the file the access log is appended to (- for standard output)
+ * -L <n>        : Log 1 in n requests (0 disables the access log); SIGUSR2 turns logging off and on
+ * -x <file>     : Write a Chrome trace of every request's phases to the file
+ * -R <n>        : Set the number of recent requests SIGUSR1 dumps (0 disables the flight recorder)
  *
  * @param argc number of command-line arguments
  * @param argv array of command-line argument strings
@@ -248,9 +906,8 @@ int main(int argc, char *argv[])
   int c;
   char *root_dir = default_root;
   int port = 10000;
-  char *sched_alg = "FIFO";
 
-  while ((c = getopt(argc, argv, "d:p:t:b:s:")) != -1)
+  while ((c = getopt(argc, argv, "d:p:t:b:s:a:w:e:o:T:k:r:H:c:C:f:q:m:I:l:L:x:R:")) != -1)
     switch (c)
     {
     case 'd':
@@ -260,90 +917,283 @@ int main(int argc, char *argv[])
       port = atoi(optarg);
       break;
     case 't':
-      num_threads = atoi(optarg);
-      if (num_threads <= 0)
+      parse_lanes(optarg, lane_threads, c);
+      break;
+    case 'b':
+      parse_lanes(optarg, lane_buffers, c);
+      break;
+    case 's':
+      parse_lanes(optarg, lane_policies, c);
+      break;
+    case 'a':
+      sched_aging_rate = atoll(optarg);
+      if (sched_aging_rate <= 0)
       {
-        fprintf(stderr, "Number of threads must be positive\n");
+        fprintf(stderr, "Aging rate must be positive\n");
         exit(1);
       }
-      if (num_threads > MAX_THREADS)
+      break;
+    case 'w':
+      sched_max_wait_ms = atoi(optarg);
+      if (sched_max_wait_ms < 0)
       {
-        fprintf(stderr, "Too many threads, maximum is %d\n", MAX_THREADS);
+        fprintf(stderr, "Maximum queue wait must not be negative\n");
         exit(1);
       }
       break;
-    case 'b':
-      buffer_size = atoi(optarg);
-      if (buffer_size <= 0)
+    case 'e':
+      sched_default_deadline_ms = atoi(optarg);
+      if (sched_default_deadline_ms <= 0)
       {
-        fprintf(stderr, "Buffer size must be positive\n");
+        fprintf(stderr, "Default deadline must be positive\n");
         exit(1);
       }
-      if (buffer_size > MAX_BUFFER_SIZE)
+      break;
+    case 'o':
+      if (strcasecmp(optarg, "block") == 0)
       {
-        fprintf(stderr, "Too many buffers, maximum is %d\n", MAX_BUFFER_SIZE);
+        overload_policy = OVERLOAD_BLOCK;
+      }
+      else if (strcasecmp(optarg, "reject") == 0)
+      {
+        overload_policy = OVERLOAD_REJECT;
+      }
+      else if (strcasecmp(optarg, "codel") == 0)
+      {
+        overload_policy = OVERLOAD_CODEL;
+      }
+      else
+      {
+        fprintf(stderr, "Invalid overload policy. Must be block, reject or codel\n");
         exit(1);
       }
       break;
-    case 's':
-      sched_alg = optarg;
-      if (strcasecmp(sched_alg, "FIFO") == 0)
+    case 'T':
+      codel_target_ms = atoi(optarg);
+      if (codel_target_ms <= 0)
+      {
+        fprintf(stderr, "CoDel target must be positive\n");
+        exit(1);
+      }
+      break;
+    case 'k':
+      keepalive_timeout = atoi(optarg);
+      if (keepalive_timeout < 0)
+      {
+        fprintf(stderr, "Keep-alive timeout must not be negative\n");
+        exit(1);
+      }
+      break;
+    case 'r':
+      keepalive_max_requests = atoi(optarg);
+      if (keepalive_max_requests <= 0)
+      {
+        fprintf(stderr, "Requests per connection must be positive\n");
+        exit(1);
+      }
+      break;
+    case 'H':
+      header_timeout = atoi(optarg);
+      if (header_timeout < 0)
+      {
+        fprintf(stderr, "Header timeout must not be negative\n");
+        exit(1);
+      }
+      break;
+    case 'c':
+      cgi_pool_size = atoi(optarg);
+      if (cgi_pool_size < 0)
+      {
+        fprintf(stderr, "Number of CGI workers must not be negative\n");
+        exit(1);
+      }
+      break;
+    case 'C':
+      cgi_pool_max_requests = atoi(optarg);
+      if (cgi_pool_max_requests < 0)
+      {
+        fprintf(stderr, "Requests per CGI worker must not be negative\n");
+        exit(1);
+      }
+      break;
+    case 'f':
+      file_cache_entries = atoi(optarg);
+      if (file_cache_entries < 0)
+      {
+        fprintf(stderr, "File cache size must not be negative\n");
+        exit(1);
+      }
+      break;
+    case 'q':
+      if (strcasecmp(optarg, "shared") == 0)
+      {
+        queue_mode = QUEUE_SHARED;
+      }
+      else if (strcasecmp(optarg, "worker") == 0)
+      {
+        queue_mode = QUEUE_WORKER;
+      }
+      else
+      {
+        fprintf(stderr, "Invalid queue layout. Must be shared or worker\n");
+        exit(1);
+      }
+      break;
+    case 'm':
+      if (strcasecmp(optarg, "single") == 0)
       {
-        scheduling_alg = FIFO;
+        server_mode = MODE_SINGLE;
+        num_cores = 1;
       }
-      else if (strcasecmp(sched_alg, "SFF") == 0)
+      else if (strncasecmp(optarg, "percore", 7) == 0 && (optarg[7] == '\0' || optarg[7] == ':'))
       {
-        scheduling_alg = SFF;
+        server_mode = MODE_PERCORE;
+        num_cores = optarg[7] == ':' ? atoi(optarg + 8) : 0;
+        if (optarg[7] == ':' && num_cores <= 0)
+        {
+          fprintf(stderr, "Number of instances must be positive\n");
+          exit(1);
+        }
       }
       else
       {
-        fprintf(stderr, "Invalid scheduling algorithm. Must be FIFO or SFF\n");
+        fprintf(stderr, "Invalid server mode. Must be single or percore\n");
+        exit(1);
+      }
+      break;
+    case 'I':
+      if (strcasecmp(optarg, "syscall") == 0)
+      {
+        io_backend = IO_BACKEND_SYSCALL;
+      }
+      else if (strcasecmp(optarg, "uring") == 0)
+      {
+        io_backend = IO_BACKEND_URING;
+      }
+      else
+      {
+        fprintf(stderr, "Invalid I/O backend. Must be syscall or uring\n");
+        exit(1);
+      }
+      break;
+    case 'l':
+      access_log_path = optarg;
+      break;
+    case 'L':
+      access_log_sample = atoi(optarg);
+      if (access_log_sample < 0)
+      {
+        fprintf(stderr, "Access log sampling rate must not be negative\n");
+        exit(1);
+      }
+      break;
+    case 'x':
+      trace_path = optarg;
+      break;
+    case 'R':
+      trace_recorder = atoi(optarg);
+      if (trace_recorder < 0)
+      {
+        fprintf(stderr, "Flight recorder size must not be negative\n");
         exit(1);
       }
       break;
     default:
-      fprintf(stderr, "usage: wserver [-d basedir] [-p port] [-t threads] [-b buffers] [-s schedalg]\n");
+      fprintf(stderr, "usage: wserver [-d basedir] [-p port] [-t threads] [-b buffers] [-s schedalg] [-a agingrate] [-w maxwait] [-e deadline] [-o overload] [-T target] [-k keepalive] [-r requests] [-H headertimeout] [-c cgiworkers] [-C cgirequests] [-f cacheentries] [-q queues] [-m mode] [-I backend] [-l accesslog] [-L sample] [-x tracefile] [-R recorder]\n");
       exit(1);
     }
 
-  // allocate request buffer
-  request_buffer = (request_t *)malloc(buffer_size * sizeof(request_t));
-  if (!request_buffer)
+  init_lanes();
+  if (queue_mode == QUEUE_WORKER &&
+      (lane_config[0].max_threads > lane_config[0].min_threads || num_lanes > 1 || server_mode == MODE_PERCORE))
+  {
+    // run queues belong to workers, so there must be a fixed number of them
+    fprintf(stderr, "An elastic pool (-t min:max), separate lanes or -m percore need -q shared\n");
+    exit(1);
+  }
+
+  // allocate the request queues and open the listeners
+  if ((queue_mode == QUEUE_WORKER && init_run_queues() < 0) || init_cores(port) < 0)
   {
-    fprintf(stderr, "Failed to allocate memory for request buffer\n");
+    fprintf(stderr, "Failed to set up the request buffers and listeners\n");
+    exit(1);
+  }
+
+  // opened before the chdir, so relative paths name files where the server was started
+  if (access_log_init(access_log_path, access_log_sample) < 0)
+  {
+    fprintf(stderr, "Failed to open the access log %s\n", access_log_path);
+    exit(1);
+  }
+  if (!getcwd(trace_dump_path, sizeof(trace_dump_path) - 64))
+    strcpy(trace_dump_path, ".");
+  sprintf(trace_dump_path + strlen(trace_dump_path), "/wserver-trace-%d.json", (int)getpid());
+  if (trace_init(trace_path, trace_recorder, trace_dump_path) < 0)
+  {
+    fprintf(stderr, "Failed to set up tracing to %s\n", trace_path ? trace_path : "the flight recorder");
     exit(1);
   }
 
   // run out of this directory
   chdir_or_die(root_dir);
 
+  // a client closing its connection must not kill the server
+  signal(SIGPIPE, SIG_IGN);
+  signal(SIGUSR1, dump_trace);
+  signal(SIGUSR2, toggle_access_log);
+
+  file_cache_init();
+  predict_init();
+  stats_init(stats_lanes);
+
   // create worker threads
-  pthread_t threads[MAX_THREADS];
-  for (int i = 0; i < num_threads; i++)
+  for (int i = 0; i < num_cores; i++)
   {
-    if (pthread_create(&threads[i], NULL, worker_thread, NULL) != 0)
+    for (int j = 0; j < num_lanes; j++)
     {
-      fprintf(stderr, "Failed to create thread %d\n", i);
-      exit(1);
+      lane_t *lane = &cores[i].lanes[j];
+      if (pool_init(&lane->pool, lane->name, lane->min_threads, lane->max_threads,
+                    worker_thread, queue_depth, lane) < 0)
+      {
+        fprintf(stderr, "Failed to create worker threads\n");
+        exit(1);
+      }
     }
   }
 
-  printf("Server starting on port %d with %d threads, %d buffers, and %s scheduling\n",
-         port, num_threads, buffer_size, sched_alg);
-
-  // get to work
-  int listen_fd = open_listen_fd_or_die(port);
-  while (1)
+  if (server_mode == MODE_PERCORE)
+    printf("Server starting on port %d with %d per-core instances, each with:\n", port, num_cores);
+  else if (num_lanes > 1)
+    printf("Server starting on port %d with separate static and dynamic lanes\n", port);
+  for (int i = 0; i < num_lanes; i++)
   {
-    struct sockaddr_in client_addr;
-    int client_len = sizeof(client_addr);
-    int conn_fd = accept_or_die(listen_fd, (sockaddr_t *)&client_addr, (socklen_t *)&client_len);
+    lane_t *lane = &lane_config[i];
+    char threads[32];
+    if (lane->max_threads > lane->min_threads)
+      sprintf(threads, "%d to %d", lane->min_threads, lane->max_threads);
+    else
+      sprintf(threads, "%d", lane->min_threads);
+    if (num_lanes == 1 && server_mode == MODE_SINGLE)
+      printf("Server starting on port %d with %s threads, %d buffers, and %s scheduling\n",
+             port, threads, lane->buffers, lane->policy->name);
+    else
+      printf("  %s lane: %s threads, %d buffers, and %s scheduling\n",
+             lane->name, threads, lane->buffers, lane->policy->name);
+  }
+  fflush(stdout); // the access log may write to the same descriptor, bypassing stdio
 
-    // add it to the buffer
-    add_request(conn_fd, client_addr);
+  // get to work: every instance but the first runs its event loop in a
+  // thread of its own, and the main thread runs the first
+  for (int i = 1; i < num_cores; i++)
+  {
+    pthread_t thread;
+    if (pthread_create(&thread, NULL, core_thread, &cores[i]) != 0)
+    {
+      fprintf(stderr, "Failed to start instance %d\n", i);
+      exit(1);
+    }
   }
+  core_thread(&cores[0]);
 
-  // clean up
-  free(request_buffer);
   return 0;
 }
\ No newline at end of file